@@ -0,0 +1,62 @@
+// alloc_counter.hpp
+/*
+  Heap allocation counter for measurements (harness.cpp).
+
+  Replaces the global operator new/delete with malloc/free wrappers that count every call, so
+  a test can check that a code path allocates nothing in steady state. allocationCount() is
+  the process-wide total. Bookkeeping that should not be counted, such as the harness's own
+  delivery statistics, runs inside an AllocationPause, which stops counting on that thread.
+
+  Defines the replacement operators, so include it in exactly one translation unit of a
+  program, and only in programs that measure allocations.
+*/
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+inline std::atomic<uint64_t> &allocationCounter() {
+    static std::atomic<uint64_t> count{0};
+    return count;
+}
+
+inline thread_local int allocationPauseDepth = 0;
+
+inline uint64_t allocationCount() { return allocationCounter().load(std::memory_order_relaxed); }
+
+struct AllocationPause {
+    AllocationPause() { allocationPauseDepth++; }
+    ~AllocationPause() { allocationPauseDepth--; }
+    AllocationPause(const AllocationPause &) = delete;
+    AllocationPause &operator=(const AllocationPause &) = delete;
+};
+
+inline void *countedAllocate(std::size_t size) {
+    if (allocationPauseDepth == 0)
+        allocationCounter().fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size) { return countedAllocate(size); }
+void *operator new[](std::size_t size) { return countedAllocate(size); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return countedAllocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return countedAllocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
@@ -0,0 +1,289 @@
+// anti_entropy.hpp
+/*
+  Building blocks for pull-based anti-entropy between neighbors.
+
+    • RecentMessages keeps a copy of the encoded frame of every gossip message a peer has seen
+      in the last `window` (at most maxMessages), so missing messages can be re-sent verbatim.
+      The copies live in SlabPool memory, so the frame that was forwarded goes back to the
+      FramePool once it is sent instead of being pinned for the whole window.
+    • Iblt is an invertible Bloom lookup table over 64-bit message ids. Two peers' tables of
+      the same size can be subtracted; if the sets differ by fewer than about cells/1.5 ids,
+      decode() lists exactly which ids only one side has, whatever the size of the sets.
+      reset() and parse() keep the cell storage, so a table reused across rounds (one per I/O
+      loop in peer.cpp) does not allocate once it has reached the largest size used.
+
+  One reconciliation round between neighbors A and B (wire.hpp DIGEST / WANT):
+      A -> B  DIGEST  "<A's set size><A's table>"
+      B       subtracts its own table of the same size and decodes the difference
+      B -> A  GOSSIP  for each id only B has
+      B -> A  WANT    ids only A has; A answers with GOSSIP frames
+  If B cannot decode, it sends an empty WANT with FRAME_RETRY and the table size to use, and
+  A repeats the round with a larger table. The set sizes let B ask for a large enough table
+  at once when A has fallen far behind (e.g. a peer that just rejoined).
+*/
+#pragma once
+#include <endian.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "dedup.hpp"
+#include "frame_pool.hpp"
+
+struct AntiEntropyConfig {
+    std::chrono::milliseconds interval{10000}; // digest exchange with each outbound neighbor
+    std::chrono::seconds window{60};           // messages older than this are not reconciled
+    size_t maxMessages = 8192;                 // recent messages kept (and reconciled) at most
+    size_t minCells = 48;                      // smallest IBLT, ~30 differences
+    size_t maxCells = 12288;                   // largest IBLT (240 KiB), ~8000 differences
+    int maxRetries = 4;                        // larger-table retries per round
+};
+
+class Iblt {
+public:
+    static const int HASHES = 3;
+    static const size_t CELL_BYTES = 20; // count (4) + idSum (8) + hashSum (8)
+
+    // cells is rounded up to a multiple of HASHES; each hash function owns one partition.
+    explicit Iblt(size_t cells = 0) : cells_((cells + HASHES - 1) / HASHES * HASHES) {}
+
+    size_t cells() const { return cells_.size(); }
+
+    // Empties the table and resizes it to cells (rounded up as in the constructor).
+    void reset(size_t cells) { cells_.assign((cells + HASHES - 1) / HASHES * HASHES, Cell()); }
+
+    void insert(uint64_t id) { update(id, 1); }
+    void erase(uint64_t id) { update(id, -1); }
+
+    // this -= other; both tables must have the same size.
+    void subtract(const Iblt &other) {
+        for (size_t i = 0; i < cells_.size(); i++) {
+            cells_[i].count -= other.cells_[i].count;
+            cells_[i].idSum ^= other.cells_[i].idSum;
+            cells_[i].hashSum ^= other.cells_[i].hashSum;
+        }
+    }
+
+    // Peels a subtracted table into ids present only on the left (count +1) and only on the
+    // right (count -1), appending them to the two lists. Returns false if the difference was
+    // too large to decode completely. Peeling happens in place: the table is consumed.
+    bool decode(std::vector<uint64_t> &onlyLeft, std::vector<uint64_t> &onlyRight) {
+        pure_.clear();
+        for (size_t i = 0; i < cells_.size(); i++)
+            if (isPure(cells_[i]))
+                pure_.push_back(i);
+        while (!pure_.empty()) {
+            size_t i = pure_.back();
+            pure_.pop_back();
+            if (!isPure(cells_[i]))
+                continue;
+            uint64_t id = cells_[i].idSum;
+            int32_t sign = cells_[i].count;
+            (sign > 0 ? onlyLeft : onlyRight).push_back(id);
+            for (int k = 0; k < HASHES; k++) {
+                size_t j = index(id, k);
+                cells_[j].count -= sign;
+                cells_[j].idSum ^= id;
+                cells_[j].hashSum ^= checksum(id);
+                if (isPure(cells_[j]))
+                    pure_.push_back(j);
+            }
+        }
+        for (auto &c : cells_)
+            if (c.count != 0 || c.idSum != 0 || c.hashSum != 0)
+                return false;
+        return true;
+    }
+
+    void serialize(std::string &out) const {
+        for (auto &c : cells_) {
+            uint32_t count = htobe32((uint32_t)c.count);
+            uint64_t idSum = htobe64(c.idSum), hashSum = htobe64(c.hashSum);
+            out.append((const char *)&count, 4);
+            out.append((const char *)&idSum, 8);
+            out.append((const char *)&hashSum, 8);
+        }
+    }
+
+    // Returns false unless data holds a whole number of cells, a multiple of HASHES.
+    bool parse(std::string_view data) {
+        if (data.size() % CELL_BYTES != 0 || (data.size() / CELL_BYTES) % HASHES != 0)
+            return false;
+        cells_.assign(data.size() / CELL_BYTES, Cell());
+        for (size_t i = 0; i < cells_.size(); i++) {
+            const char *p = data.data() + i * CELL_BYTES;
+            uint32_t count;
+            uint64_t idSum, hashSum;
+            memcpy(&count, p, 4);
+            memcpy(&idSum, p + 4, 8);
+            memcpy(&hashSum, p + 12, 8);
+            cells_[i] = {(int32_t)be32toh(count), be64toh(idSum), be64toh(hashSum)};
+        }
+        return true;
+    }
+
+    // Table size for a difference of about n ids (decoding succeeds with high probability).
+    static size_t cellsFor(size_t n) { return (n * 3 / 2 + 10 * HASHES + HASHES - 1) / HASHES * HASHES; }
+
+private:
+    struct Cell {
+        int32_t count = 0;
+        uint64_t idSum = 0;
+        uint64_t hashSum = 0;
+    };
+    std::vector<Cell> cells_;
+    std::vector<size_t> pure_; // decode()'s work list, kept for the next decode
+
+    static uint64_t checksum(uint64_t id) { return splitmix64(id ^ 0x5bd1e9955bd1e995ULL); }
+
+    size_t index(uint64_t id, int k) const {
+        size_t part = cells_.size() / HASHES;
+        return k * part + splitmix64(id + (uint64_t)(k + 1) * 0x9e3779b97f4a7c15ULL) % part;
+    }
+
+    bool isPure(const Cell &c) const { return (c.count == 1 || c.count == -1) && c.hashSum == checksum(c.idSum); }
+
+    void update(uint64_t id, int32_t delta) {
+        if (cells_.empty())
+            return;
+        for (int k = 0; k < HASHES; k++) {
+            Cell &c = cells_[index(id, k)];
+            c.count += delta;
+            c.idSum ^= id;
+            c.hashSum ^= checksum(id);
+        }
+    }
+};
+
+// Thread-safe: sharded by id like ShardedDedup, so I/O loops inserting concurrently rarely meet.
+class RecentMessages {
+public:
+    using Frame = std::shared_ptr<const std::string>;
+    using Clock = std::chrono::steady_clock;
+
+    explicit RecentMessages(const AntiEntropyConfig &cfg = AntiEntropyConfig(), int shards = 16)
+        : window_(cfg.window), perShard_(std::max<size_t>(cfg.maxMessages / std::max(shards, 1), 1)) {
+        for (int i = 0; i < std::max(shards, 1); i++) {
+            shards_.push_back(std::make_unique<Shard>());
+            shards_.back()->frames.reserve(perShard_);
+        }
+    }
+
+    void insert(uint64_t id, std::string_view frame) {
+        Shard &s = shard(id);
+        std::lock_guard<std::mutex> lock(s.mtx);
+        auto now = Clock::now();
+        expire(s, now);
+        if (!s.frames.try_emplace(id, frame.data(), frame.size()).second)
+            return;
+        s.order.push_back({id, now});
+        if (s.order.size() > perShard_) {
+            s.frames.erase(s.order.front().id);
+            s.order.pop_front();
+        }
+    }
+
+    // A pooled copy of the frame, or nullptr if it is no longer kept.
+    Frame find(uint64_t id) {
+        Shard &s = shard(id);
+        std::lock_guard<std::mutex> lock(s.mtx);
+        auto it = s.frames.find(id);
+        if (it == s.frames.end())
+            return nullptr;
+        auto frame = FramePool::instance().acquire(it->second.size());
+        frame->append(it->second.data(), it->second.size());
+        return frame;
+    }
+
+    size_t size() {
+        size_t n = 0;
+        for (auto &s : shards_) {
+            std::lock_guard<std::mutex> lock(s->mtx);
+            n += s->order.size();
+        }
+        return n;
+    }
+
+    // Rebuilds table as the IBLT of every id still in the window; size receives the number of ids.
+    void digest(Iblt &table, size_t cells, size_t &size) {
+        table.reset(cells);
+        size = 0;
+        auto now = Clock::now();
+        for (auto &s : shards_) {
+            std::lock_guard<std::mutex> lock(s->mtx);
+            expire(*s, now);
+            for (auto &entry : s->order)
+                table.insert(entry.id);
+            size += s->order.size();
+        }
+    }
+
+private:
+    struct Entry {
+        uint64_t id;
+        Clock::time_point seen;
+    };
+    using Bytes = std::basic_string<char, std::char_traits<char>, SlabAllocator<char>>;
+    struct alignas(64) Shard {
+        std::mutex mtx;
+        // Nodes, chunks and frame copies come from the SlabPool, so inserting and expiring do
+        // not allocate.
+        std::deque<Entry, SlabAllocator<Entry>> order; // oldest first
+        std::unordered_map<uint64_t, Bytes, std::hash<uint64_t>, std::equal_to<uint64_t>,
+                           SlabAllocator<std::pair<const uint64_t, Bytes>>> frames;
+    };
+
+    Clock::duration window_;
+    size_t perShard_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    Shard &shard(uint64_t id) { return *shards_[id % shards_.size()]; }
+
+    void expire(Shard &s, Clock::time_point now) {
+        while (!s.order.empty() && now - s.order.front().seen > window_) {
+            s.frames.erase(s.order.front().id);
+            s.order.pop_front();
+        }
+    }
+};
+
+// DIGEST payload: "<set size: u32><table>".
+inline void appendDigestPayload(std::string &out, size_t setSize, const Iblt &table) {
+    uint32_t n = htobe32((uint32_t)std::min<size_t>(setSize, UINT32_MAX));
+    out.append((const char *)&n, 4);
+    table.serialize(out);
+}
+
+inline bool parseDigestPayload(std::string_view payload, size_t &setSize, Iblt &table) {
+    if (payload.size() < 4)
+        return false;
+    uint32_t n;
+    memcpy(&n, payload.data(), 4);
+    setSize = be32toh(n);
+    return table.parse(payload.substr(4)) && table.cells() > 0;
+}
+
+// WANT payload: 8-byte big-endian message ids.
+inline void appendIds(std::string &out, const std::vector<uint64_t> &ids) {
+    for (uint64_t id : ids) {
+        uint64_t be = htobe64(id);
+        out.append((const char *)&be, 8);
+    }
+}
+
+// Replaces the contents of ids with the ids in payload.
+inline void parseIds(std::string_view payload, std::vector<uint64_t> &ids) {
+    ids.clear();
+    for (size_t off = 0; off + 8 <= payload.size(); off += 8) {
+        uint64_t be;
+        memcpy(&be, payload.data() + off, 8);
+        ids.push_back(be64toh(be));
+    }
+}
@@ -0,0 +1,226 @@
+// attachment.hpp
+/*
+  Degree-proportional sampling for NetworkBuilder (pl.hpp), O(1) per sample.
+
+    • sample_global() is global preferential attachment: any node, with probability
+      proportional to its degree. Every edge appends both of its ends to one endpoint array, so
+      a node appears there degree times and a uniform slot is a degree-weighted node. 8 bytes
+      per edge.
+    • sample_neighbor() is one random-walk step: a neighbor of the current node, with
+      probability proportional to the neighbor's degree. A node with fewer than
+      SCAN_LIMIT neighbors is scanned, which is bounded. Larger nodes (the hubs the walks keep
+      crossing) get an alias table (Walker, Vose) over their neighbor list. A table is built on
+      first use and rebuilt lazily, after the node gains a quarter more neighbors or the
+      graph a quarter more edges. Between rebuilds a step uses the degrees from when the
+      table was built, and a neighbor added since is picked uniformly in proportion to its
+      share of the list, so every neighbor stays reachable. Each rebuild costs O(degree) and
+      follows constant-factor growth, so a build's total rebuild work is O(E log E).
+    • refresh() brings every table up to date at once, including tables for nodes that
+      have reached SCAN_LIMIT since the last call. After that, the const
+      sample_neighbor() can be called from several threads while the graph is not changing.
+      It never rebuilds: it uses the table as it stands, or scans a node that has none.
+
+  Samples take one 64-bit draw, so Rng must be a full 64-bit engine: std::mt19937_64, or
+  SplitMix64 where one stream per task must be cheap to seed. Ids are those of the
+  AdjacencyStore (overlay_graph.hpp) passed in. Not thread-safe apart from the const calls.
+*/
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "overlay_graph.hpp"
+
+// Steele, Lea and Flood's SplitMix64: a 64-bit engine whose state is one word, so seeding
+// one stream per peer or per thread from a master seed costs nothing. Distinct seeds give
+// well-mixed, independent-looking streams.
+class SplitMix64 {
+public:
+    using result_type = uint64_t;
+    explicit SplitMix64(uint64_t seed = 0) : state_(seed) {}
+
+    // The stream for task `index` of a run seeded with `master`.
+    static SplitMix64 stream(uint64_t master, uint64_t index) {
+        SplitMix64 mix(master ^ (index * 0xd1342543de82ef95ULL));
+        return SplitMix64(mix());
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    result_type operator()() {
+        uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+private:
+    uint64_t state_;
+};
+
+class AttachmentSampler {
+public:
+    static const uint32_t SCAN_LIMIT = 16;
+
+    // Records the edge a-b; call once per edge added to the graph.
+    void add_edge(uint32_t a, uint32_t b) {
+        endpoints_.push_back(a);
+        endpoints_.push_back(b);
+    }
+
+    // A node with probability proportional to its degree; NO_NODE while there are no edges.
+    template <class Rng>
+    uint32_t sample_global(Rng &rng) const {
+        check_engine<Rng>();
+        if (endpoints_.empty())
+            return NO_NODE;
+        return endpoints_[scale(rng() >> 32, endpoints_.size())];
+    }
+
+    // A neighbor of node with probability proportional to the neighbor's degree; NO_NODE if
+    // node has no neighbors.
+    template <class Rng>
+    uint32_t sample_neighbor(const AdjacencyStore &graph, uint32_t node, Rng &rng) {
+        check_engine<Rng>();
+        NeighborRange neighbors = graph.neighbors(node);
+        if (neighbors.empty())
+            return NO_NODE;
+        uint64_t r = rng();
+        if (neighbors.size() < SCAN_LIMIT)
+            return scan(graph, neighbors, r);
+        return draw(table_for(graph, node), neighbors, r);
+    }
+
+    // As above without rebuilding any table, so the sampler is only read.
+    template <class Rng>
+    uint32_t sample_neighbor(const AdjacencyStore &graph, uint32_t node, Rng &rng) const {
+        check_engine<Rng>();
+        NeighborRange neighbors = graph.neighbors(node);
+        if (neighbors.empty())
+            return NO_NODE;
+        uint64_t r = rng();
+        if (node >= table_of_.size() || table_of_[node] == NO_NODE)
+            return scan(graph, neighbors, r);
+        return draw(tables_[table_of_[node]], neighbors, r);
+    }
+
+    // Builds or rebuilds, as sample_neighbor() would, every table that is missing or stale:
+    // those of nodes on edges added since the last call, then the rest. O(new edges + tables).
+    void refresh(const AdjacencyStore &graph) {
+        for (size_t i = refreshed_; i < endpoints_.size(); i++)
+            if (graph.degree(endpoints_[i]) >= SCAN_LIMIT)
+                table_for(graph, endpoints_[i]);
+        refreshed_ = endpoints_.size();
+        for (size_t t = 0; t < tables_.size(); t++)
+            table_for(graph, tables_[t].node);
+    }
+
+    size_t memory_bytes() const {
+        size_t bytes = endpoints_.capacity() * sizeof(uint32_t) + table_of_.capacity() * sizeof(uint32_t) +
+                       tables_.capacity() * sizeof(AliasTable);
+        for (const AliasTable &table : tables_)
+            bytes += table.slots.capacity() * sizeof(Slot);
+        return bytes;
+    }
+
+private:
+    struct Slot {
+        uint32_t threshold; // keep this slot when the low 32 bits of the draw are below it
+        uint32_t alias;     // the other neighbor index in the slot
+    };
+
+    struct AliasTable {
+        std::vector<Slot> slots;  // one per neighbor covered, in neighbor-list order
+        size_t built_edges = 0;   // graph edge count at the last build
+        uint32_t node = NO_NODE;
+    };
+
+    std::vector<uint32_t> endpoints_;  // both ends of every edge
+    std::vector<uint32_t> table_of_;   // node id -> index in tables_, NO_NODE for none
+    std::vector<AliasTable> tables_;
+    size_t refreshed_ = 0;             // endpoints_ seen by refresh()
+    std::vector<double> scaled_;       // build scratch
+    std::vector<uint32_t> small_, large_;
+
+    template <class Rng>
+    static void check_engine() {
+        static_assert(Rng::min() == 0 && Rng::max() == std::numeric_limits<uint64_t>::max(),
+                      "AttachmentSampler needs a 64-bit engine");
+    }
+
+    // x * n / 2^32 for a 32-bit x: uniform in [0, n) without a division.
+    static uint64_t scale(uint64_t x, uint64_t n) { return (x * n) >> 32; }
+
+    static uint32_t draw(const AliasTable &table, NeighborRange neighbors, uint64_t r) {
+        uint64_t i = scale(r >> 32, neighbors.size());
+        if (i >= table.slots.size())
+            return neighbors[i]; // added since the table was built
+        const Slot &slot = table.slots[i];
+        return neighbors[(uint32_t)r < slot.threshold ? i : slot.alias];
+    }
+
+    // Picks a neighbor by running through the degree sums of a short list.
+    static uint32_t scan(const AdjacencyStore &graph, NeighborRange neighbors, uint64_t r) {
+        uint64_t total = 0;
+        for (uint32_t neighbor : neighbors)
+            total += graph.degree(neighbor);
+        uint64_t pick = scale(r >> 32, total);
+        for (uint32_t neighbor : neighbors) {
+            if (pick < graph.degree(neighbor))
+                return neighbor;
+            pick -= graph.degree(neighbor);
+        }
+        return neighbors[neighbors.size() - 1];
+    }
+
+    const AliasTable &table_for(const AdjacencyStore &graph, uint32_t node) {
+        if (node >= table_of_.size())
+            table_of_.resize(graph.node_count(), NO_NODE);
+        if (table_of_[node] == NO_NODE) {
+            table_of_[node] = (uint32_t)tables_.size();
+            tables_.emplace_back();
+            tables_.back().node = node;
+            build(graph, node, tables_.back());
+            return tables_.back();
+        }
+        AliasTable &table = tables_[table_of_[node]];
+        size_t covered = table.slots.size();
+        if (graph.degree(node) > covered + covered / 4 || graph.edge_count() > table.built_edges + table.built_edges / 4)
+            build(graph, node, table);
+        return table;
+    }
+
+    // Vose's alias method over the current degrees of node's neighbors.
+    void build(const AdjacencyStore &graph, uint32_t node, AliasTable &table) {
+        NeighborRange neighbors = graph.neighbors(node);
+        size_t n = neighbors.size();
+        uint64_t total = 0;
+        for (uint32_t neighbor : neighbors)
+            total += graph.degree(neighbor);
+
+        table.slots.resize(n);
+        table.built_edges = graph.edge_count();
+        scaled_.resize(n);
+        small_.clear();
+        large_.clear();
+        for (size_t i = 0; i < n; i++) {
+            scaled_[i] = (double)graph.degree(neighbors[i]) * n / total;
+            (scaled_[i] < 1.0 ? small_ : large_).push_back((uint32_t)i);
+        }
+        while (!small_.empty() && !large_.empty()) {
+            uint32_t s = small_.back(), l = large_.back();
+            small_.pop_back();
+            table.slots[s] = {(uint32_t)(scaled_[s] * 4294967296.0), l};
+            scaled_[l] -= 1.0 - scaled_[s];
+            if (scaled_[l] < 1.0) {
+                large_.pop_back();
+                small_.push_back(l);
+            }
+        }
+        // What is left has probability 1 up to rounding.
+        for (uint32_t i : large_)
+            table.slots[i] = {UINT32_MAX, i};
+        for (uint32_t i : small_)
+            table.slots[i] = {UINT32_MAX, i};
+    }
+};
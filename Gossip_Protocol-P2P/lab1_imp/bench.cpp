@@ -0,0 +1,563 @@
+// bench.cpp
+// Micro-benchmarks for the lab1_imp building blocks.
+// Build: g++ -std=c++17 -O2 bench.cpp -o bench -pthread
+// Usage: ./bench <name> [iterations]     (./bench with no arguments lists the benchmarks)
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <malloc.h>
+#include <random>
+#include "wire.hpp"
+#include "dedup.hpp"
+#include "logger.hpp"
+#include "cow.hpp"
+#include "pl.hpp"
+using namespace std;
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static void report(const string &name, size_t messages, size_t bytes, double secs) {
+    cout << name << ": " << messages << " msgs in " << secs << " s  (" << (size_t)(messages / secs) << " msgs/s";
+    if (bytes > 0)
+        cout << ", " << (bytes / secs) / (1 << 20) << " MiB/s";
+    cout << ")" << endl;
+}
+
+// ------------------------------
+// wire: text messages vs. length-prefixed frames
+// ------------------------------
+// Receives a stream of gossip messages with one PING every 16 messages, delivered in 1024-byte
+// reads as on the socket. The text path mirrors the original receiver: one std::string per
+// message, find("PING") == 0 dispatch, and a copy for the history entry. Text messages get a
+// '\n' delimiter so the baseline at least parses correctly.
+static void benchWire(size_t iterations) {
+    const size_t chunk = 1024;
+    vector<string> messages;
+    for (size_t i = 0; i < 1000; i++)
+        messages.push_back("2025-02-14 12:00:00:127.0.0.1:Msg#" + to_string(i));
+
+    string textStream, frameStream;
+    for (size_t i = 0; i < messages.size(); i++) {
+        if (i % 16 == 0) {
+            textStream += "PING\n";
+            appendFrame(frameStream, MsgType::Ping, 1, i, 0);
+        }
+        textStream += messages[i] + "\n";
+        appendFrame(frameStream, MsgType::Gossip, 1, i, 0, messages[i]);
+    }
+
+    size_t textMsgs = 0, textBytes = 0, sink = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t it = 0; it < iterations; it++) {
+        string carry;
+        for (size_t off = 0; off < textStream.size(); off += chunk) {
+            carry += string(textStream, off, chunk);
+            size_t pos;
+            while ((pos = carry.find('\n')) != string::npos) {
+                string recvMsg = carry.substr(0, pos);
+                carry.erase(0, pos + 1);
+                if (recvMsg.find("PING") == 0) {
+                    sink++;
+                } else {
+                    string entry(recvMsg);
+                    sink += entry.size();
+                }
+                textMsgs++;
+            }
+        }
+        textBytes += textStream.size();
+    }
+    double textSecs = secondsSince(start);
+
+    size_t frameMsgs = 0, frameBytes = 0;
+    start = chrono::steady_clock::now();
+    for (size_t it = 0; it < iterations; it++) {
+        FrameReader reader;
+        for (size_t off = 0; off < frameStream.size(); off += chunk) {
+            // Copy one "read()" worth of bytes, as much as fits at a time.
+            const char *src = frameStream.data() + off;
+            size_t n = min(chunk, frameStream.size() - off);
+            while (n > 0) {
+                char *dst = reader.writePtr();
+                size_t k = min(n, reader.writable());
+                memcpy(dst, src, k);
+                reader.commit(k);
+                src += k;
+                n -= k;
+                reader.consume([&](const FrameHeader &h, string_view payload) {
+                    if (h.type == MsgType::Ping)
+                        sink++;
+                    else
+                        sink += payload.size();
+                    frameMsgs++;
+                    return true;
+                });
+            }
+        }
+        frameBytes += frameStream.size();
+    }
+    double frameSecs = secondsSince(start);
+
+    report("text  ", textMsgs, textBytes, textSecs);
+    report("framed", frameMsgs, frameBytes, frameSecs);
+    cout << "speedup: " << (textSecs / frameSecs) << "x  (sink " << sink << ")" << endl;
+}
+
+// ------------------------------
+// dedup: unordered_set<string> history vs. MessageDedup
+// ------------------------------
+// Every message is seen twice (first copy + one duplicate from another neighbor).
+static void benchDedup(size_t iterations) {
+    size_t n = iterations * 100;
+    vector<string> texts;
+    texts.reserve(n);
+    for (size_t i = 0; i < n; i++)
+        texts.push_back("2025-02-14 12:00:00:127.0.0.1:Msg#" + to_string(i));
+
+    size_t fresh = 0;
+    auto start = chrono::steady_clock::now();
+    {
+        unordered_set<string> history;
+        for (int pass = 0; pass < 2; pass++)
+            for (auto &t : texts)
+                if (history.insert(t).second)
+                    fresh++;
+        // Node + bucket + string heap block, roughly.
+        size_t approx = history.size() * (sizeof(string) + 2 * sizeof(void *) + 48) +
+                        history.bucket_count() * sizeof(void *);
+        cout << "unordered_set<string>: ~" << approx / 1024 << " KiB, ";
+    }
+    report("set   ", 2 * n, 0, secondsSince(start));
+
+    DedupConfig cfg;
+    cfg.memoryBytes = 1 << 20;
+    MessageDedup dedup(cfg);
+    start = chrono::steady_clock::now();
+    for (int pass = 0; pass < 2; pass++)
+        for (size_t i = 0; i < n; i++)
+            dedup.checkAndInsert(messageId(1, i));
+    cout << "MessageDedup: " << dedup.memoryBytes() / 1024 << " KiB, ";
+    report("dedup ", 2 * n, 0, secondsSince(start));
+    cout << dedup.summary() << " (fresh via set " << fresh << ")" << endl;
+}
+
+// ------------------------------
+// log: ofstream + endl under a mutex vs. the async Logger
+// ------------------------------
+// Four threads each log `iterations` lines to bench_log.txt (removed afterwards).
+static void benchLog(size_t iterations) {
+    const int threads = 4;
+    const char *path = "bench_log.txt";
+    string line = "2025-02-14 12:00:00 - Received new gossip from 127.0.0.1: 2025-02-14 12:00:00:127.0.0.1:Msg#1";
+
+    auto runThreads = [&](auto fn) {
+        auto start = chrono::steady_clock::now();
+        vector<thread> ts;
+        for (int t = 0; t < threads; t++)
+            ts.emplace_back(fn);
+        for (auto &t : ts)
+            t.join();
+        return secondsSince(start);
+    };
+
+    {
+        ofstream out(path, ios::out);
+        mutex mtx;
+        double secs = runThreads([&] {
+            for (size_t i = 0; i < iterations; i++) {
+                lock_guard<mutex> lock(mtx);
+                out << line << endl;
+            }
+        });
+        report("ofstream+endl", threads * iterations, threads * iterations * (line.size() + 1), secs);
+    }
+
+    LoggerConfig cfg;
+    cfg.path = path;
+    cfg.toStdout = false;
+    Logger &logger = Logger::instance();
+    logger.configure(cfg);
+    double secs = runThreads([&] {
+        for (size_t i = 0; i < iterations; i++)
+            logger.log(line);
+    });
+    report("async logger ", threads * iterations, threads * iterations * (line.size() + 1), secs);
+    logger.flush();
+    cout << "logger writes=" << logger.writes() << " bytes=" << logger.bytesWritten()
+         << " dropped=" << logger.dropped() << endl;
+    remove(path);
+}
+
+// ------------------------------
+// contention: one global mutex vs. sharded dedup + copy-on-write neighbor table
+// ------------------------------
+// Models the per-message work of a peer's receive path: check the gossip id against the
+// dedup filter, then walk the neighbor table to pick forwarding targets. The baseline guards
+// both with one mutex (the original PeerNode::mtx); the split version uses ShardedDedup and a
+// CopyOnWrite table read through a per-thread cache. A writer thread changes the table every
+// millisecond to model neighbor churn. Runs with 1, 2, 4, ... threads up to the core count.
+static void benchContention(size_t iterations) {
+    size_t perThread = iterations * 500;
+    unsigned maxThreads = max(2u, thread::hardware_concurrency());
+    unordered_map<string, int> initial;
+    for (int i = 0; i < 8; i++)
+        initial["10.0.0." + to_string(i) + ":5000"] = i;
+
+    auto runThreads = [&](unsigned threads, auto worker, auto writer) {
+        atomic<bool> stop{false};
+        thread churn([&] {
+            while (!stop) {
+                writer();
+                this_thread::sleep_for(chrono::milliseconds(1));
+            }
+        });
+        auto start = chrono::steady_clock::now();
+        vector<thread> ts;
+        for (unsigned t = 0; t < threads; t++)
+            ts.emplace_back(worker, t);
+        for (auto &t : ts)
+            t.join();
+        double secs = secondsSince(start);
+        stop = true;
+        churn.join();
+        return secs;
+    };
+
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        size_t sink = 0;
+        mutex globalMtx;
+        MessageDedup globalDedup;
+        unordered_map<string, int> globalTable = initial;
+        double lockedSecs = runThreads(threads, [&](unsigned t) {
+            size_t local = 0;
+            for (size_t i = 0; i < perThread; i++) {
+                lock_guard<mutex> lock(globalMtx);
+                if (globalDedup.checkAndInsert(messageId(t + 1, i)))
+                    for (auto &entry : globalTable)
+                        local += entry.second;
+            }
+            lock_guard<mutex> lock(globalMtx);
+            sink += local;
+        }, [&] {
+            lock_guard<mutex> lock(globalMtx);
+            globalTable["10.0.0.9:5000"]++;
+        });
+
+        ShardedDedup sharded;
+        CopyOnWrite<unordered_map<string, int>> table;
+        table.update([&](unordered_map<string, int> &m) { m = initial; });
+        double splitSecs = runThreads(threads, [&](unsigned t) {
+            CopyOnWrite<unordered_map<string, int>>::Cache cache;
+            size_t local = 0;
+            for (size_t i = 0; i < perThread; i++) {
+                if (sharded.checkAndInsert(messageId(t + 1, i)))
+                    for (auto &entry : table.read(cache))
+                        local += entry.second;
+            }
+            static mutex sinkMtx;
+            lock_guard<mutex> lock(sinkMtx);
+            sink += local;
+        }, [&] {
+            table.update([](unordered_map<string, int> &m) { m["10.0.0.9:5000"]++; });
+        });
+
+        size_t msgs = threads * perThread;
+        cout << "threads=" << threads << endl;
+        report("  global mutex ", msgs, 0, lockedSecs);
+        report("  sharded + cow", msgs, 0, splitSecs);
+        cout << "  speedup: " << (lockedSecs / splitSecs) << "x  (sink " << sink << ")" << endl;
+    }
+}
+
+// ------------------------------
+// topology: shared_ptr hash-set adjacency vs. interned ids + adjacency store
+// ------------------------------
+// Grows an overlay of `peers` peers with NetworkBuilder and reports the build time and the
+// heap it holds, then copies the same nodes and edges into the original layout (a Node per name
+// holding an unordered_set<shared_ptr<Node>>, found through an unordered_map by name) and
+// reports the heap that takes. Heap use is glibc's mallinfo2() before and after. Last, it
+// writes the overlay as a topology file and times mapping it back and validating it.
+static size_t heapInUse() {
+    struct mallinfo2 m = mallinfo2();
+    return m.uordblks + m.hblkhd; // large blocks are mmap()ed and counted apart
+}
+
+static void benchTopology(size_t peers) {
+    struct OldNode {
+        string id;
+        unordered_set<shared_ptr<OldNode>> connections;
+    };
+
+    size_t before = heapInUse();
+    auto start = chrono::steady_clock::now();
+    NetworkBuilder builder(2.5, 2, 10);
+    builder.add_seed_nodes({"Seed1", "Seed2", "Seed3"});
+    for (size_t i = 0; i < peers; i++)
+        builder.add_peer("Peer" + to_string(i));
+    double buildSecs = secondsSince(start);
+    size_t newHeap = heapInUse() - before;
+    start = chrono::steady_clock::now();
+    CsrGraph csr = builder.freeze();
+    double freezeSecs = secondsSince(start);
+    size_t csrHeap = heapInUse() - before - newHeap;
+
+    before = heapInUse();
+    {
+        unordered_map<string, shared_ptr<OldNode>> nodes;
+        vector<shared_ptr<OldNode>> byId;
+        for (uint32_t id = 0; id < builder.node_count(); id++) {
+            auto node = make_shared<OldNode>();
+            node->id = string(builder.name(id));
+            nodes[node->id] = node;
+            byId.push_back(node);
+        }
+        for (uint32_t id = 0; id < builder.node_count(); id++)
+            for (uint32_t nbr : builder.graph().neighbors(id))
+                byId[id]->connections.insert(byId[nbr]);
+        byId.clear();
+        byId.shrink_to_fit();
+        size_t oldHeap = heapInUse() - before;
+        size_t n = builder.node_count(), e = builder.edge_count();
+        cout << "nodes=" << n << " edges=" << e << " build " << buildSecs << " s ("
+             << (size_t)(peers / buildSecs) << " peers/s), freeze " << freezeSecs << " s" << endl;
+        cout << "  shared_ptr sets: " << oldHeap / (1 << 20) << " MiB (" << oldHeap / n << " B/node)" << endl;
+        cout << "  interned + store: " << newHeap / (1 << 20) << " MiB (" << newHeap / n << " B/node, "
+             << builder.memory_bytes() / (1 << 20) << " MiB reserved)" << endl;
+        cout << "  csr: " << csrHeap / (1 << 20) << " MiB (" << csrHeap / n << " B/node)" << endl;
+        cout << "  ratio: " << (double)oldHeap / newHeap << "x" << endl;
+        PowerLawFit fit = builder.power_law_fit();
+        cout << "  fit: alpha=" << fit.alpha << " +/- " << fit.std_error << " ks=" << builder.goodness_of_fit() << endl;
+        for (auto &entry : nodes)
+            entry.second->connections.clear(); // break the cycles so the nodes are freed
+    }
+
+    const string path = "bench-topology.bin";
+    start = chrono::steady_clock::now();
+    if (!builder.write_topology(path))
+        return;
+    double writeSecs = secondsSince(start);
+    {
+        MappedTopology topo;
+        start = chrono::steady_clock::now();
+        bool opened = topo.open(path);
+        double openSecs = secondsSince(start);
+        start = chrono::steady_clock::now();
+        bool valid = opened && topo.validate();
+        double validateSecs = secondsSince(start);
+        cout << "  file: " << topo.file_bytes() / 1024 << " KiB, write " << writeSecs * 1e3 << " ms, open "
+             << openSecs * 1e6 << " us, validate " << validateSecs * 1e3 << " ms" << (valid ? "" : " (INVALID)") << endl;
+    }
+    unlink(path.c_str());
+}
+
+// ------------------------------
+// attachment: per-step discrete_distribution vs. degree scan vs. alias tables
+// ------------------------------
+// Grows an overlay of `peers` peers in each AttachmentMode and reports the build rate and fit.
+// Then runs the same 10-step random walks over the random-walk overlay three ways: the original
+// step (copy the neighbors, build a probability vector and a fresh discrete_distribution), the
+// degree-sum scan, and AttachmentSampler's alias tables. It also times global sampling from
+// the endpoint array. Last, it checks the alias table of the biggest hub: the total variation
+// distance between its sampled and exact neighbor frequencies.
+static void benchAttachment(size_t peers) {
+    const AttachmentMode modes[] = {AttachmentMode::RANDOM_WALK, AttachmentMode::GLOBAL};
+    const char *modeNames[] = {"random walk", "global"};
+    auto grow = [&](NetworkBuilder &b, int m) {
+        b.set_attachment_mode(modes[m]);
+        b.add_seed_nodes({"Seed1", "Seed2", "Seed3"});
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < peers; i++)
+            b.add_peer("Peer" + to_string(i));
+        double secs = secondsSince(start);
+        PowerLawFit fit = b.power_law_fit();
+        cout << "build (" << modeNames[m] << "): " << peers << " peers in " << secs << " s ("
+             << (size_t)(peers / secs) << " peers/s), edges=" << b.edge_count() << " alpha=" << fit.alpha
+             << " ks=" << b.goodness_of_fit() << endl;
+    };
+    NetworkBuilder builder(2.5, 2, 10);
+    grow(builder, 0);
+    {
+        NetworkBuilder global(2.5, 2, 10);
+        grow(global, 1);
+    }
+
+    const AdjacencyStore &graph = builder.graph();
+    uint32_t n = (uint32_t)graph.node_count();
+    AttachmentSampler sampler;
+    for (uint32_t id = 0; id < n; id++)
+        for (uint32_t nbr : graph.neighbors(id))
+            if (id < nbr)
+                sampler.add_edge(id, nbr);
+
+    const size_t walks = 20000, steps = 10;
+    vector<uint32_t> starts(walks);
+    mt19937_64 rng(42);
+    for (auto &s : starts)
+        s = uint32_t(rng() % n);
+    uint64_t sink = 0;
+    auto timeWalks = [&](const char *name, auto step) {
+        auto start = chrono::steady_clock::now();
+        for (uint32_t current : starts) {
+            for (size_t i = 0; i < steps; i++)
+                current = step(current);
+            sink += current;
+        }
+        double secs = secondsSince(start);
+        cout << "  " << name << ": " << walks * steps << " steps in " << secs << " s  ("
+             << (size_t)(walks * steps / secs) << " samples/s)" << endl;
+        return secs;
+    };
+
+    mt19937 rng32(42);
+    double originalSecs = timeWalks("discrete_distribution", [&](uint32_t current) {
+        NeighborRange r = graph.neighbors(current);
+        vector<uint32_t> neighbors(r.begin(), r.end());
+        vector<double> probabilities;
+        for (uint32_t nbr : neighbors)
+            probabilities.push_back((double)graph.degree(nbr));
+        discrete_distribution<size_t> dist(probabilities.begin(), probabilities.end());
+        return neighbors[dist(rng32)];
+    });
+    double scanSecs = timeWalks("degree scan", [&](uint32_t current) {
+        NeighborRange r = graph.neighbors(current);
+        uint64_t total = 0;
+        for (uint32_t nbr : r)
+            total += graph.degree(nbr);
+        uint64_t pick = uniform_int_distribution<uint64_t>(0, total - 1)(rng);
+        for (uint32_t nbr : r) {
+            if (pick < graph.degree(nbr))
+                return nbr;
+            pick -= graph.degree(nbr);
+        }
+        return current;
+    });
+    double aliasSecs = timeWalks("alias tables", [&](uint32_t current) {
+        return sampler.sample_neighbor(graph, current, rng);
+    });
+    double globalSecs = timeWalks("global endpoints", [&](uint32_t) { return sampler.sample_global(rng); });
+    cout << "  speedup vs. discrete_distribution: scan " << originalSecs / scanSecs << "x, alias "
+         << originalSecs / aliasSecs << "x, global " << originalSecs / globalSecs << "x" << endl;
+    cout << "  speedup vs. scan: alias " << scanSecs / aliasSecs << "x  (sink " << sink << ")" << endl;
+
+    uint32_t hub = 0;
+    for (uint32_t id = 1; id < n; id++)
+        if (graph.degree(id) > graph.degree(hub))
+            hub = id;
+    NeighborRange r = graph.neighbors(hub);
+    unordered_map<uint32_t, size_t> seen;
+    const size_t draws = 4000000;
+    for (size_t i = 0; i < draws; i++)
+        seen[sampler.sample_neighbor(graph, hub, rng)]++;
+    double total = 0, tv = 0, noise = 0;
+    for (uint32_t nbr : r)
+        total += graph.degree(nbr);
+    for (uint32_t nbr : r) {
+        double p = graph.degree(nbr) / total;
+        tv += abs((double)seen[nbr] / draws - p);
+        noise += sqrt(2 * p * (1 - p) / (M_PI * draws)); // expected |error| of an exact sampler
+    }
+    cout << "  hub degree " << graph.degree(hub) << ": total variation distance " << tv / 2 << " over "
+         << draws << " draws (" << noise / 2 << " expected from sampling alone), sampler "
+         << sampler.memory_bytes() / 1024 << " KiB" << endl;
+}
+
+// ------------------------------
+// bulk: add_peer() one at a time vs. add_peers() on 1..N threads
+// ------------------------------
+// Builds the same `peers` peers from one seed with add_peer() and with add_peers() on 1, 2, 4
+// and hardware_concurrency() threads, reporting the rate and fit of each, and the time
+// add_peers() spent in its parallel and sequential phases. The add_peers() graphs are frozen
+// and compared, including a second run on the first thread count, and must be identical.
+static void benchBulk(size_t peers) {
+    vector<string> ids;
+    for (size_t i = 0; i < peers; i++)
+        ids.push_back("Peer" + to_string(i));
+    auto describe = [&](const string &name, NetworkBuilder &b, double secs) {
+        PowerLawFit fit = b.power_law_fit();
+        cout << name << ": " << peers << " peers in " << secs << " s (" << (size_t)(peers / secs)
+             << " peers/s), edges=" << b.edge_count() << " alpha=" << fit.alpha << " ks=" << b.goodness_of_fit() << endl;
+    };
+    {
+        NetworkBuilder b(2.5, 2, 10);
+        b.seed(1);
+        b.add_seed_nodes({"Seed1", "Seed2", "Seed3"});
+        auto start = chrono::steady_clock::now();
+        for (const string &id : ids)
+            b.add_peer(id);
+        describe("add_peer", b, secondsSince(start));
+    }
+    unsigned cores = max(1u, thread::hardware_concurrency());
+    vector<unsigned> threadCounts = {1, 2, 4};
+    if (cores > 4)
+        threadCounts.push_back(cores);
+    threadCounts.push_back(1);
+    CsrGraph reference;
+    bool identical = true;
+    for (size_t i = 0; i < threadCounts.size(); i++) {
+        NetworkBuilder b(2.5, 2, 10);
+        b.seed(1);
+        b.add_seed_nodes({"Seed1", "Seed2", "Seed3"});
+        auto start = chrono::steady_clock::now();
+        b.add_peers(ids, threadCounts[i]);
+        describe("add_peers x" + to_string(threadCounts[i]), b, secondsSince(start));
+        double parallel = b.bulk_parallel_seconds(), sequential = b.bulk_sequential_seconds();
+        cout << "  parallel phase " << parallel << " s, sequential phase " << sequential << " s";
+        if (i == 0) // one thread: the sequential share bounds the speedup from more threads
+            cout << " (" << 100 * sequential / (parallel + sequential) << "% sequential, so at most "
+                 << (parallel + sequential) / sequential << "x faster on any core count)";
+        cout << endl;
+        CsrGraph csr = b.freeze();
+        if (i == 0)
+            reference = move(csr);
+        else if (csr.offsets != reference.offsets || csr.targets != reference.targets)
+            identical = false;
+    }
+    cout << "  graphs " << (identical ? "identical" : "DIFFER") << " across thread counts and runs ("
+         << cores << " cores)" << endl;
+}
+
+int main(int argc, char *argv[]) {
+    string name = argc > 1 ? argv[1] : "";
+    size_t iterations = argc > 2 ? strtoul(argv[2], nullptr, 10) : 2000;
+    if (name == "wire")
+        benchWire(iterations);
+    else if (name == "dedup")
+        benchDedup(iterations);
+    else if (name == "log")
+        benchLog(iterations * 100);
+    else if (name == "contention")
+        benchContention(iterations);
+    else if (name == "topology")
+        benchTopology(argc > 2 ? iterations : 20000);
+    else if (name == "bulk")
+        benchBulk(argc > 2 ? iterations : 1000000);
+    else if (name == "attachment")
+        benchAttachment(argc > 2 ? iterations : 20000);
+    else {
+        cerr << "Usage: " << argv[0] << " <benchmark> [iterations]" << endl
+             << "Benchmarks:" << endl
+             << "  wire     text vs. framed message parsing" << endl
+             << "  dedup    string-set vs. Bloom-generation duplicate suppression" << endl
+             << "  log      ofstream+endl under a mutex vs. the async batched logger" << endl
+             << "  contention  global mutex vs. sharded dedup + copy-on-write neighbor table" << endl
+             << "  topology    shared_ptr hash-set adjacency vs. interned ids (iterations = peers, default 20000)" << endl
+             << "  bulk        add_peer() vs. add_peers() on 1..N threads, and determinism (iterations = peers, default 1000000)" << endl
+             << "  attachment  discrete_distribution vs. scan vs. alias-table degree sampling (iterations = peers)" << endl;
+        return 1;
+    }
+    return 0;
+}
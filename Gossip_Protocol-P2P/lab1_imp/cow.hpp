@@ -0,0 +1,74 @@
+// cow.hpp
+/*
+  CopyOnWrite<T>: read-mostly shared state with RCU-style snapshots.
+
+  update(fn) copies the current value, applies fn to the copy and publishes it with a new
+  version number; concurrent writers are serialized by a mutex that readers never touch. A
+  published version is immutable and is freed when its last reader drops it.
+
+  Readers have two options:
+    • read() returns the current version as a shared_ptr<const T>. Simple, but every call
+      goes through std::atomic_load on a shared_ptr (a short internal lock in libstdc++).
+    • read(cache) with a Cache owned by the reading thread (e.g. one per event loop) returns
+      a reference to that thread's cached snapshot and costs one atomic load of the version
+      while nothing has changed, so readers on different cores never write shared memory.
+      The reference stays valid until the next read(cache) on the same cache.
+
+  Meant for small tables that are read on every message and changed rarely (e.g. the neighbor
+  table read by every forward and changed on connect/disconnect).
+*/
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+template <typename T>
+class CopyOnWrite {
+    struct Node {
+        uint64_t version;
+        T value;
+    };
+
+public:
+    class Cache {
+        friend class CopyOnWrite;
+        uint64_t version_ = UINT64_MAX;
+        std::shared_ptr<const Node> node_;
+    };
+
+    CopyOnWrite() : data_(std::make_shared<const Node>(Node{0, T()})) {}
+
+    std::shared_ptr<const T> read() const {
+        std::shared_ptr<const Node> node = std::atomic_load(&data_);
+        return std::shared_ptr<const T>(node, &node->value);
+    }
+
+    const T &read(Cache &cache) const {
+        uint64_t v = version_.load(std::memory_order_acquire);
+        if (cache.version_ != v) {
+            cache.node_ = std::atomic_load(&data_);
+            cache.version_ = cache.node_->version;
+        }
+        return cache.node_->value;
+    }
+
+    template <typename F>
+    void update(F &&fn) {
+        std::lock_guard<std::mutex> lock(writeMtx_);
+        std::shared_ptr<const Node> cur = std::atomic_load(&data_);
+        auto copy = std::make_shared<Node>(*cur);
+        fn(copy->value);
+        copy->version = cur->version + 1;
+        uint64_t v = copy->version;
+        std::atomic_store(&data_, std::shared_ptr<const Node>(std::move(copy)));
+        version_.store(v, std::memory_order_release);
+    }
+
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+private:
+    std::shared_ptr<const Node> data_; // accessed with std::atomic_load/store
+    alignas(64) std::atomic<uint64_t> version_{0};
+    std::mutex writeMtx_;
+};
@@ -0,0 +1,290 @@
+// datagram.hpp
+/*
+  DatagramSocket: one nonblocking UDP socket that carries a peer's framed traffic (wire.hpp)
+  to and from all of its neighbors, with system calls batched in both directions.
+
+    • queue(to, frame) only records the frame. flush() packs the frames queued for each
+      destination into datagrams of at most datagramBytes (frames are never split; a larger
+      frame travels alone, up to MAX_DATAGRAM) and passes up to BATCH datagrams to the kernel
+      per sendmmsg(), each gathered straight from the shared frame buffers. Control frames
+      (TrafficClass, wire.hpp) get datagrams of their own that go out before any data, and
+      stay first in line when the socket blocks.
+    • receive(fn) drains the socket with recvmmsg(), BATCH datagrams per call, and calls
+      fn(from, header, payload) for every frame in them, up to the first malformed frame:
+      the control frames of each batch first, then its data frames.
+
+  UDP does not guarantee delivery. A datagram the kernel refuses is dropped and counted, except
+  that on EAGAIN flush() keeps the rest queued and returns Blocked. PeerNode can acknowledge
+  and retransmit gossip on top of this (UdpConfig::retransmit).
+
+  Not thread-safe; the socket belongs to one event loop (counters may be read from anywhere).
+*/
+#pragma once
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "outbound_queue.hpp"
+#include "wire.hpp"
+
+enum class Transport { Tcp, Udp };
+
+struct UdpConfig {
+    size_t datagramBytes = 1472;         // coalescing limit: one Ethernet MTU, no fragmentation
+    size_t maxQueued = 65536;            // frames waiting for the socket before new ones drop
+    int socketBufferBytes = 4 << 20;     // SO_SNDBUF / SO_RCVBUF
+    bool retransmit = false;             // acknowledge gossip and resend unacknowledged frames
+    std::chrono::milliseconds rto{50};   // first retransmission timeout, doubled per attempt
+    int maxRetries = 3;
+    std::chrono::seconds idleTimeout{60}; // an endpoint that dialed us is forgotten after this silence
+};
+
+// Key of an IPv4 endpoint, laid out like makeOriginId().
+inline uint64_t endpointKey(const sockaddr_in &a) {
+    return ((uint64_t)ntohl(a.sin_addr.s_addr) << 16) | ntohs(a.sin_port);
+}
+
+class DatagramSocket {
+public:
+    using Frame = std::shared_ptr<const std::string>;
+    enum class FlushResult { Drained, Blocked };
+    static const int BATCH = 64;
+    static const size_t MAX_DATAGRAM = 65507; // largest UDP payload over IPv4
+
+    explicit DatagramSocket(const UdpConfig &cfg = UdpConfig()) : cfg_(cfg) {}
+
+    ~DatagramSocket() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    DatagramSocket(const DatagramSocket &) = delete;
+    DatagramSocket &operator=(const DatagramSocket &) = delete;
+
+    void configure(const UdpConfig &cfg) { cfg_ = cfg; }
+
+    // Records the queueing delay of every frame sent from now on into delays (may be null).
+    void trackDelays(QueueDelays *delays) { delays_ = delays; }
+
+    // Binds a nonblocking socket to ip:port. Returns false (errno set) on failure.
+    bool open(const std::string &ip, int port) {
+        fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd_ < 0)
+            return false;
+        setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &cfg_.socketBufferBytes, sizeof(int));
+        setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &cfg_.socketBufferBytes, sizeof(int));
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = inet_addr(ip.c_str());
+        addr.sin_port = htons(port);
+        if (bind(fd_, (sockaddr *)&addr, sizeof(addr)) < 0) {
+            close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        for (auto &slot : slots_)
+            slot.reset(new char[MAX_DATAGRAM]); // left uninitialized: only received bytes get touched
+        return true;
+    }
+
+    int fd() const { return fd_; }
+    bool pending() const { return !queue_.empty(); }
+
+    void queue(const sockaddr_in &to, Frame frame) {
+        if (queue_.size() >= cfg_.maxQueued) {
+            dropped_++;
+            return;
+        }
+        TrafficClass cls = trafficClassOf(*frame);
+        queue_.push_back({to, std::move(frame), cls, delays_ ? monotonicNs() : 0});
+    }
+
+    FlushResult flush() {
+        // Control frames first, then group by destination, keeping each destination's frames in
+        // order. The scratch vectors are members so a steady flow of flushes does not allocate.
+        order_.clear();
+        for (size_t i = 0; i < queue_.size(); i++)
+            order_.push_back({queue_[i].cls, endpointKey(queue_[i].to), i});
+        std::sort(order_.begin(), order_.end());
+        iov_.clear();
+        iovFrames_.clear();
+        datagrams_.clear();
+        size_t bytes = 0;
+        for (size_t k = 0; k < order_.size(); k++) {
+            const Out &out = queue_[order_[k].index];
+            size_t size = out.frame->size();
+            if (size > MAX_DATAGRAM) {
+                dropped_++;
+                continue;
+            }
+            const Order &first = order_[datagrams_.empty() ? 0 : datagrams_.back().firstOrder];
+            bool sameDatagram = !datagrams_.empty() && first.cls == order_[k].cls && first.dest == order_[k].dest;
+            if (!sameDatagram || bytes + size > cfg_.datagramBytes) {
+                datagrams_.push_back({k, iov_.size(), 0});
+                bytes = 0;
+            }
+            iov_.push_back({(void *)out.frame->data(), size});
+            iovFrames_.push_back(order_[k].index);
+            datagrams_.back().iovs++;
+            bytes += size;
+        }
+        size_t sentDatagrams = 0;
+        while (sentDatagrams < datagrams_.size()) {
+            size_t n = std::min<size_t>(BATCH, datagrams_.size() - sentDatagrams);
+            mmsghdr msgs[BATCH];
+            memset(msgs, 0, sizeof(mmsghdr) * n);
+            for (size_t i = 0; i < n; i++) {
+                const Datagram &d = datagrams_[sentDatagrams + i];
+                msgs[i].msg_hdr.msg_name = (void *)&queue_[order_[d.firstOrder].index].to;
+                msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+                msgs[i].msg_hdr.msg_iov = &iov_[d.firstIov];
+                msgs[i].msg_hdr.msg_iovlen = d.iovs;
+            }
+            int sent = sendmmsg(fd_, msgs, n, MSG_DONTWAIT | MSG_NOSIGNAL);
+            sendCalls_++;
+            if (sent < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    // Keep what is left, grouped and in order, for the next writable event.
+                    std::vector<Out> rest;
+                    for (size_t k = datagrams_[sentDatagrams].firstOrder; k < order_.size(); k++)
+                        rest.push_back(std::move(queue_[order_[k].index]));
+                    queue_.swap(rest);
+                    return FlushResult::Blocked;
+                }
+                // sendmmsg() reports an error for the first datagram only; skip it.
+                dropped_ += datagrams_[sentDatagrams].iovs;
+                sentDatagrams++;
+                continue;
+            }
+            uint64_t now = delays_ ? monotonicNs() : 0;
+            for (int i = 0; i < sent; i++) {
+                const Datagram &d = datagrams_[sentDatagrams + i];
+                framesSent_ += d.iovs;
+                if (delays_)
+                    for (size_t j = d.firstIov; j < d.firstIov + d.iovs; j++)
+                        delays_->record(queue_[iovFrames_[j]].cls, now - queue_[iovFrames_[j]].queuedNs);
+            }
+            datagramsSent_ += sent;
+            sentDatagrams += sent;
+        }
+        queue_.clear();
+        return FlushResult::Drained;
+    }
+
+    // Calls onFrame(const sockaddr_in &from, const FrameHeader &, std::string_view payload) for
+    // every frame received until the socket is empty.
+    template <typename F>
+    void receive(F &&onFrame) {
+        while (true) {
+            mmsghdr msgs[BATCH];
+            iovec iov[BATCH];
+            sockaddr_in from[BATCH];
+            memset(msgs, 0, sizeof(msgs));
+            for (int i = 0; i < BATCH; i++) {
+                iov[i] = {slots_[i].get(), MAX_DATAGRAM};
+                msgs[i].msg_hdr.msg_iov = &iov[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+                msgs[i].msg_hdr.msg_name = &from[i];
+                msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            }
+            int n = recvmmsg(fd_, msgs, BATCH, MSG_DONTWAIT, nullptr);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                return; // EAGAIN, or an error the next datagram will not have
+            }
+            recvCalls_++;
+            datagramsReceived_ += n;
+            for (TrafficClass cls : {TrafficClass::Control, TrafficClass::Data})
+                for (int i = 0; i < n; i++)
+                    parse(from[i], std::string_view(slots_[i].get(), msgs[i].msg_len), cls, onFrame);
+            if (n < BATCH)
+                return;
+        }
+    }
+
+    // "udp datagrams_sent=<n> frames_sent=<n> sendmmsg=<n> datagrams_received=<n> recvmmsg=<n> dropped=<n> malformed=<n>"
+    std::string summary() const {
+        std::ostringstream oss;
+        oss << "udp datagrams_sent=" << datagramsSent_ << " frames_sent=" << framesSent_ << " sendmmsg=" << sendCalls_
+            << " datagrams_received=" << datagramsReceived_ << " recvmmsg=" << recvCalls_ << " dropped=" << dropped_
+            << " malformed=" << malformed_;
+        return oss.str();
+    }
+
+    uint64_t datagramsSent() const { return datagramsSent_; }
+    uint64_t sendCalls() const { return sendCalls_; }
+    uint64_t datagramsReceived() const { return datagramsReceived_; }
+    uint64_t recvCalls() const { return recvCalls_; }
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    struct Out {
+        sockaddr_in to;
+        Frame frame;
+        TrafficClass cls;
+        uint64_t queuedNs; // monotonicNs() at queue(), when delays are tracked
+    };
+
+    struct Order {
+        TrafficClass cls;
+        uint64_t dest;
+        size_t index; // into queue_
+        bool operator<(const Order &o) const {
+            return cls != o.cls ? cls < o.cls : dest != o.dest ? dest < o.dest : index < o.index;
+        }
+    };
+
+    struct Datagram {
+        size_t firstOrder, firstIov, iovs; // first frame (index into order_) and its iovecs
+    };
+
+    UdpConfig cfg_;
+    int fd_ = -1;
+    std::vector<Out> queue_;
+    std::vector<Order> order_;
+    std::vector<Datagram> datagrams_;
+    std::vector<iovec> iov_;
+    std::vector<size_t> iovFrames_; // queue_ index of each iovec
+    QueueDelays *delays_ = nullptr;
+    std::unique_ptr<char[]> slots_[BATCH];
+    std::atomic<uint64_t> datagramsSent_{0}, framesSent_{0}, sendCalls_{0};
+    std::atomic<uint64_t> datagramsReceived_{0}, recvCalls_{0}, dropped_{0}, malformed_{0};
+
+    // A datagram holds whole frames back to back; parsing stops at the first malformed one.
+    // Passes on the frames of class cls only; malformed datagrams are counted in the data pass.
+    template <typename F>
+    void parse(const sockaddr_in &from, std::string_view data, TrafficClass cls, F &onFrame) {
+        size_t off = 0;
+        while (off < data.size()) {
+            if (data.size() - off < FRAME_HEADER_SIZE || (uint8_t)data[off + 1] != WIRE_VERSION) {
+                malformed_ += cls == TrafficClass::Data;
+                return;
+            }
+            FrameHeader h = decodeHeader(data.data() + off);
+            if (h.payloadLen > data.size() - off - FRAME_HEADER_SIZE) {
+                malformed_ += cls == TrafficClass::Data;
+                return;
+            }
+            if (trafficClassOf(h.type) == cls)
+                onFrame(from, h, data.substr(off + FRAME_HEADER_SIZE, h.payloadLen));
+            off += FRAME_HEADER_SIZE + h.payloadLen;
+        }
+    }
+};
@@ -0,0 +1,214 @@
+// dedup.hpp
+/*
+  MessageDedup: bounded-memory duplicate suppression for gossip.
+
+  Messages are identified by a 64-bit id (messageId(originId, seq) for framed gossip, or
+  hashMessage(text) where only the text exists). Ids are recorded in a ring of Bloom filter
+  generations:
+    • Inserts go to the newest generation; lookups test all of them.
+    • The oldest generation is cleared and reused when the newest one is full (reached the
+      capacity that keeps its false-positive rate on target) or older than window/generations.
+  So memory is fixed at memoryBytes, an id is remembered for at least one generation lifetime,
+  and the overall false-positive rate (a new message wrongly suppressed) stays at or below
+  falsePositiveRate.
+
+  MessageDedup is not thread-safe; the owner serializes access. ShardedDedup splits the id
+  space over independently locked MessageDedup shards so threads checking different messages
+  rarely contend.
+*/
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+inline uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+inline uint64_t messageId(uint64_t originId, uint64_t seq) {
+    return splitmix64(originId * 0x100000001b3ULL ^ splitmix64(seq));
+}
+
+// FNV-1a, for messages that are only known by their text.
+inline uint64_t hashMessage(std::string_view text) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char c : text) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+struct DedupConfig {
+    size_t memoryBytes = 1 << 20;        // total bit-array memory across generations
+    double falsePositiveRate = 1e-6;     // target probability of suppressing a new message
+    std::chrono::seconds window{600};    // how long an id is remembered at most
+    int generations = 4;
+};
+
+class MessageDedup {
+public:
+    explicit MessageDedup(const DedupConfig &cfg = DedupConfig()) : cfg_(cfg) {
+        if (cfg_.generations < 2)
+            cfg_.generations = 2;
+        // All of the memory cap, in whole words; bit indexes are reduced by multiply-shift, so
+        // the size need not be a power of two.
+        bits_ = std::max<size_t>((cfg_.memoryBytes * 8) / cfg_.generations / 64 * 64, 64);
+        // Each generation targets fp/generations so that a lookup across all of them meets fp.
+        double p = cfg_.falsePositiveRate / cfg_.generations;
+        double ln2 = std::log(2.0);
+        capacity_ = (size_t)(-(double)bits_ * ln2 * ln2 / std::log(p));
+        if (capacity_ == 0)
+            capacity_ = 1;
+        hashes_ = (int)std::lround((double)bits_ / capacity_ * ln2);
+        if (hashes_ < 1)
+            hashes_ = 1;
+        gens_.resize(cfg_.generations);
+        for (auto &g : gens_) {
+            g.words.assign(bits_ / 64, 0);
+            g.count = 0;
+            g.created = Clock::now();
+        }
+    }
+
+    // Returns true if id was not seen before (and records it), false for a duplicate.
+    bool checkAndInsert(uint64_t id) {
+        uint64_t h1 = splitmix64(id);
+        uint64_t h2 = splitmix64(h1) | 1;
+        for (size_t i = 0; i < gens_.size(); i++) {
+            if (test(gens_[i], h1, h2)) {
+                duplicates_++;
+                return false;
+            }
+        }
+        Generation &cur = gens_[current_];
+        if (cur.count >= capacity_ || Clock::now() - cur.created >= generationLifetime())
+            rotate();
+        set(gens_[current_], h1, h2);
+        gens_[current_].count++;
+        inserted_++;
+        return true;
+    }
+
+    uint64_t duplicatesSuppressed() const { return duplicates_; }
+    uint64_t inserted() const { return inserted_; }
+    uint64_t rotations() const { return rotations_; }
+    size_t memoryBytes() const { return gens_.size() * bits_ / 8; }
+    // Ids each generation holds before it is rotated out.
+    size_t generationCapacity() const { return capacity_; }
+
+    std::string summary() const {
+        std::ostringstream oss;
+        oss << "dedup inserted=" << inserted_ << " duplicates=" << duplicates_
+            << " rotations=" << rotations_ << " mem_bytes=" << memoryBytes()
+            << " gen_capacity=" << capacity_ << " hashes=" << hashes_;
+        return oss.str();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Generation {
+        std::vector<uint64_t> words;
+        size_t count;
+        Clock::time_point created;
+    };
+
+    DedupConfig cfg_;
+    size_t bits_;
+    size_t capacity_;
+    int hashes_;
+    std::vector<Generation> gens_;
+    size_t current_ = 0;
+    uint64_t inserted_ = 0;
+    uint64_t duplicates_ = 0;
+    uint64_t rotations_ = 0;
+
+    Clock::duration generationLifetime() const {
+        return std::chrono::duration_cast<Clock::duration>(cfg_.window) / cfg_.generations;
+    }
+
+    // Maps a 64-bit hash onto [0, bits_) without a division.
+    uint64_t bitIndex(uint64_t h) const { return (uint64_t)(((unsigned __int128)h * bits_) >> 64); }
+
+    bool test(const Generation &g, uint64_t h1, uint64_t h2) const {
+        if (g.count == 0)
+            return false;
+        for (int i = 0; i < hashes_; i++) {
+            uint64_t bit = bitIndex(h1 + (uint64_t)i * h2);
+            if (!(g.words[bit >> 6] & (1ULL << (bit & 63))))
+                return false;
+        }
+        return true;
+    }
+
+    void set(Generation &g, uint64_t h1, uint64_t h2) {
+        for (int i = 0; i < hashes_; i++) {
+            uint64_t bit = bitIndex(h1 + (uint64_t)i * h2);
+            g.words[bit >> 6] |= 1ULL << (bit & 63);
+        }
+    }
+
+    // Reuses the oldest generation as the new current one.
+    void rotate() {
+        current_ = (current_ + 1) % gens_.size();
+        Generation &g = gens_[current_];
+        std::fill(g.words.begin(), g.words.end(), 0);
+        g.count = 0;
+        g.created = Clock::now();
+        rotations_++;
+    }
+};
+
+// Thread-safe dedup: `shards` MessageDedups, each with its own lock and memoryBytes/shards of
+// the memory budget. Ids are already well mixed, so id % shards spreads them evenly.
+class ShardedDedup {
+public:
+    explicit ShardedDedup(const DedupConfig &cfg = DedupConfig(), int shards = 16) {
+        if (shards < 1)
+            shards = 1;
+        DedupConfig shardCfg = cfg;
+        shardCfg.memoryBytes = std::max<size_t>(cfg.memoryBytes / shards, 64);
+        for (int i = 0; i < shards; i++)
+            shards_.push_back(std::make_unique<Shard>(shardCfg));
+    }
+
+    bool checkAndInsert(uint64_t id) {
+        Shard &s = *shards_[id % shards_.size()];
+        std::lock_guard<std::mutex> lock(s.mtx);
+        return s.dedup.checkAndInsert(id);
+    }
+
+    std::string summary() {
+        uint64_t inserted = 0, duplicates = 0, rotations = 0;
+        size_t mem = 0;
+        for (auto &s : shards_) {
+            std::lock_guard<std::mutex> lock(s->mtx);
+            inserted += s->dedup.inserted();
+            duplicates += s->dedup.duplicatesSuppressed();
+            rotations += s->dedup.rotations();
+            mem += s->dedup.memoryBytes();
+        }
+        std::ostringstream oss;
+        oss << "dedup shards=" << shards_.size() << " inserted=" << inserted << " duplicates=" << duplicates
+            << " rotations=" << rotations << " mem_bytes=" << mem;
+        return oss.str();
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::mutex mtx;
+        MessageDedup dedup;
+        explicit Shard(const DedupConfig &cfg) : dedup(cfg) {}
+    };
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
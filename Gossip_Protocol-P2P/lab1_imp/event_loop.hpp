@@ -0,0 +1,227 @@
+// event_loop.hpp
+/*
+  EventLoop is a small epoll-based reactor:
+    • Each registered fd owns a handler that is called with the ready epoll events.
+    • Handlers may add/remove fds (including their own) while being dispatched; removed
+      handlers are destroyed only after the current batch of events is processed.
+    • post() queues a closure from any thread and wakes the loop through an eventfd.
+      postUrgent() does the same through a separate queue and lock that is drained first,
+      for control-plane work that must not wait behind a backlog of posted data work.
+    • defer() queues a closure from the loop thread itself to run once the current batch of
+      events, posted closures and timers is done (e.g. to coalesce writes).
+    • runAfter()/runEvery() schedule one-shot and periodic timers on the loop thread. Timers
+      live in a hierarchical TimerWheel (1 ms ticks), so scheduling and cancelling are O(1)
+      even with thousands of per-neighbor probe timeouts pending.
+  One EventLoop is driven by exactly one thread calling run().
+*/
+#pragma once
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "timer_wheel.hpp"
+
+class EventLoop {
+public:
+    using Handler = std::function<void(uint32_t events)>;
+    using Clock = std::chrono::steady_clock;
+    using TimerId = TimerWheel::TimerId;
+
+    EventLoop() {
+        epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd_ < 0) {
+            perror("epoll_create1");
+            exit(EXIT_FAILURE);
+        }
+        wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeFd_ < 0) {
+            perror("eventfd");
+            exit(EXIT_FAILURE);
+        }
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = wakeFd_;
+        epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &ev);
+    }
+
+    ~EventLoop() {
+        close(wakeFd_);
+        close(epollFd_);
+    }
+
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    // Registers fd with the given epoll event mask (e.g. EPOLLIN | EPOLLET).
+    bool add(int fd, uint32_t events, Handler handler) {
+        struct epoll_event ev = {};
+        ev.events = events;
+        ev.data.fd = fd;
+        if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            perror("epoll_ctl ADD");
+            return false;
+        }
+        handlers_[fd] = std::make_shared<Handler>(std::move(handler));
+        return true;
+    }
+
+    bool modify(int fd, uint32_t events) {
+        struct epoll_event ev = {};
+        ev.events = events;
+        ev.data.fd = fd;
+        return epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev) == 0;
+    }
+
+    // Unregisters fd. The caller still owns (and closes) the descriptor.
+    void remove(int fd) {
+        epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+        auto it = handlers_.find(fd);
+        if (it != handlers_.end()) {
+            retired_.push_back(std::move(it->second));
+            handlers_.erase(it);
+        }
+    }
+
+    // Thread-safe: runs fn on the loop thread during the next iteration.
+    void post(std::function<void()> fn) {
+        {
+            std::lock_guard<std::mutex> lock(postMtx_);
+            posted_.push_back(std::move(fn));
+        }
+        uint64_t one = 1;
+        if (write(wakeFd_, &one, sizeof(one)) < 0) {
+            // Counter saturation only; the loop is already awake.
+        }
+    }
+
+    // Like post(), but fn runs before every closure queued with post().
+    void postUrgent(std::function<void()> fn) {
+        {
+            std::lock_guard<std::mutex> lock(urgentMtx_);
+            urgent_.push_back(std::move(fn));
+        }
+        uint64_t one = 1;
+        if (write(wakeFd_, &one, sizeof(one)) < 0) {
+            // Counter saturation only; the loop is already awake.
+        }
+    }
+
+    // Loop thread only: runs fn after the current iteration's handlers, posts and timers.
+    void defer(std::function<void()> fn) { deferred_.push_back(std::move(fn)); }
+
+    // Timers must be scheduled/cancelled from the loop thread (use post() from elsewhere).
+    TimerId runAfter(Clock::duration delay, std::function<void()> fn) {
+        return timers_.schedule(delay, Clock::duration::zero(), std::move(fn));
+    }
+
+    TimerId runEvery(Clock::duration interval, std::function<void()> fn) {
+        return timers_.schedule(interval, interval, std::move(fn));
+    }
+
+    // Like runEvery(), but the first run happens after firstDelay (e.g. to stagger timers).
+    TimerId runEvery(Clock::duration firstDelay, Clock::duration interval, std::function<void()> fn) {
+        return timers_.schedule(firstDelay, interval, std::move(fn));
+    }
+
+    void cancel(TimerId id) { timers_.cancel(id); }
+
+    void stop() {
+        running_ = false;
+        post([] {});
+    }
+
+    bool inLoopThread() const { return std::this_thread::get_id() == owner_; }
+
+    size_t handlerCount() const { return handlers_.size(); }
+
+    void run() {
+        owner_ = std::this_thread::get_id();
+        running_ = true;
+        std::vector<struct epoll_event> events(256);
+        while (running_) {
+            int n = epoll_wait(epollFd_, events.data(), (int)events.size(), timers_.msUntilNext(Clock::now()));
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                perror("epoll_wait");
+                break;
+            }
+            for (int i = 0; i < n; i++) {
+                int fd = events[i].data.fd;
+                if (fd == wakeFd_) {
+                    uint64_t cnt;
+                    while (read(wakeFd_, &cnt, sizeof(cnt)) > 0) {}
+                    continue;
+                }
+                auto it = handlers_.find(fd);
+                if (it == handlers_.end())
+                    continue;
+                std::shared_ptr<Handler> h = it->second;
+                (*h)(events[i].events);
+            }
+            runPosted();
+            timers_.advance(Clock::now());
+            runDeferred();
+            retired_.clear();
+            if (n == (int)events.size())
+                events.resize(events.size() * 2);
+        }
+    }
+
+private:
+    int epollFd_ = -1;
+    int wakeFd_ = -1;
+    std::atomic<bool> running_{false};
+    std::thread::id owner_;
+    std::unordered_map<int, std::shared_ptr<Handler>> handlers_;
+    std::vector<std::shared_ptr<Handler>> retired_;
+    std::mutex postMtx_;
+    std::vector<std::function<void()>> posted_;
+    std::vector<std::function<void()>> postedBatch_;
+    std::mutex urgentMtx_;
+    std::vector<std::function<void()>> urgent_;
+    std::vector<std::function<void()>> urgentBatch_;
+    std::vector<std::function<void()>> deferred_;
+    std::vector<std::function<void()>> deferredBatch_;
+    TimerWheel timers_;
+
+    // Deferred closures may defer more work; that runs in the same pass.
+    void runDeferred() {
+        while (!deferred_.empty()) {
+            deferredBatch_.clear();
+            deferredBatch_.swap(deferred_);
+            for (auto &fn : deferredBatch_)
+                fn();
+        }
+    }
+
+    // The batch vector is kept so its capacity is reused: posting allocates only when a pass
+    // sees more closures than any pass before it.
+    void runPosted() {
+        {
+            std::lock_guard<std::mutex> lock(urgentMtx_);
+            urgentBatch_.swap(urgent_);
+        }
+        for (auto &fn : urgentBatch_)
+            fn();
+        urgentBatch_.clear();
+        {
+            std::lock_guard<std::mutex> lock(postMtx_);
+            postedBatch_.swap(posted_);
+        }
+        for (auto &fn : postedBatch_)
+            fn();
+        postedBatch_.clear();
+    }
+};
@@ -0,0 +1,184 @@
+// frame_pool.hpp
+/*
+  Allocation-free buffers for the gossip receive-to-forward path.
+
+    • SlabPool hands out small fixed-size blocks (16-byte size classes up to MAX_BLOCK) carved
+      from 64 KiB slabs and keeps freed blocks on a per-class free list. Slabs are never
+      returned to the system, so once the pool has grown to the working set, allocating and
+      freeing a block is a pop and a push under an uncontended per-class lock. SlabAllocator<T>
+      adapts it for containers and shared_ptr control blocks.
+    • FramePool recycles the strings that hold encoded frames. acquire() returns a cleared
+      string that keeps its earlier capacity, owned by a shared_ptr whose control block
+      comes from the SlabPool; when the last reference drops (on any thread) the string goes
+      back to the pool instead of being freed. Strings that grew past MIN_CAPACITY (digests,
+      WANT lists) are kept on their own list and handed to requests that need the room, so
+      large frames do not keep regrowing gossip-sized strings. The frame type stays
+      std::shared_ptr<const std::string>, so queues and rumor state share one encoded copy
+      per message as before.
+
+  Both are process-wide singletons and thread-safe: a frame built on one event loop is often
+  released by another.
+*/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+class SlabPool {
+public:
+    static const size_t MAX_BLOCK = 1024;   // larger requests go to operator new
+    static const size_t SLAB_BYTES = 64 * 1024;
+
+    static SlabPool &instance() {
+        static SlabPool *pool = new SlabPool(); // never destroyed: blocks may be freed during exit
+        return *pool;
+    }
+
+    void *allocate(size_t bytes) {
+        if (bytes > MAX_BLOCK)
+            return ::operator new(bytes);
+        SizeClass &c = classes_[classOf(bytes)];
+        std::lock_guard<std::mutex> lock(c.mtx);
+        if (!c.free)
+            refill(c, (classOf(bytes) + 1) * 16);
+        FreeBlock *b = c.free;
+        c.free = b->next;
+        return b;
+    }
+
+    void deallocate(void *p, size_t bytes) {
+        if (bytes > MAX_BLOCK) {
+            ::operator delete(p);
+            return;
+        }
+        SizeClass &c = classes_[classOf(bytes)];
+        std::lock_guard<std::mutex> lock(c.mtx);
+        c.free = new (p) FreeBlock{c.free};
+    }
+
+    uint64_t slabs() const { return slabs_.load(); }
+
+private:
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+    struct alignas(64) SizeClass {
+        std::mutex mtx;
+        FreeBlock *free = nullptr;
+    };
+    SizeClass classes_[MAX_BLOCK / 16];
+    std::atomic<uint64_t> slabs_{0};
+
+    static size_t classOf(size_t bytes) { return bytes == 0 ? 0 : (bytes - 1) / 16; }
+
+    void refill(SizeClass &c, size_t blockBytes) {
+        char *slab = static_cast<char *>(::operator new(SLAB_BYTES));
+        slabs_++;
+        for (size_t off = 0; off + blockBytes <= SLAB_BYTES; off += blockBytes)
+            c.free = new (slab + off) FreeBlock{c.free};
+    }
+};
+
+template <typename T>
+struct SlabAllocator {
+    using value_type = T;
+
+    SlabAllocator() = default;
+    template <typename U>
+    SlabAllocator(const SlabAllocator<U> &) {}
+
+    T *allocate(size_t n) { return static_cast<T *>(SlabPool::instance().allocate(n * sizeof(T))); }
+    void deallocate(T *p, size_t n) { SlabPool::instance().deallocate(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const SlabAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const SlabAllocator<U> &) const { return false; }
+};
+
+class FramePool {
+public:
+    static const size_t MAX_POOLED_BYTES = 64 * 1024; // bigger strings (large digests) are freed
+    static const size_t MAX_POOLED = 1 << 16;         // strings kept at most
+    static const size_t MIN_CAPACITY = 256;           // fits any gossip frame, so reuse never regrows
+
+    static FramePool &instance() {
+        static FramePool *pool = new FramePool(); // never destroyed, like SlabPool
+        return *pool;
+    }
+
+    // An empty string with room for at least `reserve` bytes.
+    std::shared_ptr<std::string> acquire(size_t reserve = 0) {
+        std::string *s = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            bool large = reserve > MIN_CAPACITY;
+            std::vector<std::string *> &first = large ? large_ : free_, &second = large ? free_ : large_;
+            std::vector<std::string *> &from = !first.empty() ? first : second;
+            if (!from.empty()) {
+                s = from.back();
+                from.pop_back();
+            }
+        }
+        if (s)
+            recycled_.fetch_add(1, std::memory_order_relaxed);
+        else
+            s = new std::string();
+        acquired_.fetch_add(1, std::memory_order_relaxed);
+        s->reserve(std::max(reserve, (size_t)MIN_CAPACITY)); // by value: MIN_CAPACITY has no definition
+        return std::shared_ptr<std::string>(s, Recycle{this}, SlabAllocator<char>());
+    }
+
+    uint64_t acquired() const { return acquired_.load(std::memory_order_relaxed); }
+    // Acquisitions that found the pool empty and allocated a new string.
+    uint64_t misses() const { return acquired() - recycled_.load(std::memory_order_relaxed); }
+
+    // "frames acquired=<n> recycled=<n> pooled=<n> slabs=<n>"
+    std::string summary() {
+        std::ostringstream oss;
+        size_t pooled;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            pooled = free_.size() + large_.size();
+        }
+        oss << "frames acquired=" << acquired_.load() << " recycled=" << recycled_.load() << " pooled=" << pooled
+            << " slabs=" << SlabPool::instance().slabs();
+        return oss.str();
+    }
+
+private:
+    struct Recycle {
+        FramePool *pool;
+        void operator()(std::string *s) const { pool->release(s); }
+    };
+
+    std::mutex mtx_;
+    std::vector<std::string *> free_;  // capacity MIN_CAPACITY
+    std::vector<std::string *> large_; // grown past MIN_CAPACITY
+    std::atomic<uint64_t> acquired_{0};
+    std::atomic<uint64_t> recycled_{0};
+
+    FramePool() {
+        free_.reserve(MAX_POOLED);
+        large_.reserve(MAX_POOLED);
+    }
+
+    void release(std::string *s) {
+        if (s->capacity() <= MAX_POOLED_BYTES) {
+            s->clear();
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (free_.size() + large_.size() < MAX_POOLED) {
+                (s->capacity() > MIN_CAPACITY ? large_ : free_).push_back(s);
+                return;
+            }
+        }
+        delete s;
+    }
+};
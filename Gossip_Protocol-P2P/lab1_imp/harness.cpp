@@ -0,0 +1,479 @@
+// harness.cpp
+// In-process load harness: starts S seeds and N real PeerNodes on 127.0.0.1, drives gossip at a
+// fixed network-wide rate and reports sustained deliveries/sec, CPU use, end-to-end delivery
+// latency (origin timestamp to first receipt) and hop percentiles, how long messages take to
+// reach every peer they reach, and how long control (PING/PONG) and data frames wait in the send
+// queues. Heap allocations in the measured window (after --warmup) are counted (alloc_counter.hpp)
+// so the per-delivery allocation rate of the nodes shows up next to their CPU cost, along with
+// the FramePool acquisitions in the window that found the pool empty.
+// Build: g++ -std=c++17 -O2 harness.cpp -o harness -pthread
+// Usage: ./harness [options]
+//   --seeds=N                 seed servers (default: 3)
+//   --peers=N                 peer nodes (default: 100)
+//   --neighbors=N             outbound neighbors each peer dials at bootstrap (default: 3)
+//   --base-port=P             first port; seeds take P.., peers follow (default: 20000)
+//   --rate=N                  gossip messages/sec generated across the network (default: 100)
+//   --warmup=S                seconds of gossip before measuring (default: 2)
+//   --duration=S              measured seconds (default: 10)
+//   --drain=S                 extra seconds to follow messages generated in the window (default: 1)
+//   --peer-threads=N          event loops per peer (default: 1)
+//   --seed-mode=threaded|reactor, --seed-threads=N   as in main.cpp (default: reactor, 1)
+//   --seed-replicas=N         sharded seed membership, as in main.cpp (default: 0, unsharded)
+//   --queue-high-kb=N, --queue-low-kb=N, --queue-policy=drop-oldest|disconnect   as in main.cpp
+//   --dedup-kb=N              duplicate filter memory per peer (default: 64)
+//   --forward=flood|rumor, --fanout=N, --ttl=N, --rumor-k=N   as in main.cpp
+//   --transport=tcp|udp, --udp-retransmit                    as in main.cpp
+//   --anti-entropy-ms=N       digest exchange interval, 0 to disable (default: 10000)
+//   --recent=N                recent gossip frames each peer keeps for anti-entropy (default: 8192)
+//   --log=PATH                node log file (default: harness.log; nothing goes to stdout)
+//   --topology=FILE           seeds, peers and links from a topology file (nb --out=FILE) instead
+//                             of --seeds/--peers/--base-port and bootstrap through the seeds
+#include <sys/resource.h>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <numeric>
+#include <cstdlib>
+#include "seed.cpp"
+#include "peer.cpp"
+#include "histogram.hpp"
+#include "propagation.hpp"
+#include "alloc_counter.hpp"
+using namespace std;
+
+struct HarnessConfig {
+    int seeds = 3;
+    int peers = 100;
+    int neighbors = 3;
+    int basePort = 20000;
+    double rate = 100;
+    double warmupSecs = 2;
+    double durationSecs = 10;
+    double drainSecs = 1;
+    int peerThreads = 1;
+    SeedMode seedMode = SeedMode::Reactor;
+    int seedLoops = 1;
+    int seedReplicas = 0;
+    OutboundConfig outbound;
+    RumorConfig rumor;
+    Transport transport = Transport::Tcp;
+    UdpConfig udp;
+    size_t dedupBytes = 64 << 10;
+    int antiEntropyMs = 10000;
+    size_t recentMessages = AntiEntropyConfig().maxMessages;
+    string logPath = "harness.log";
+    string topologyPath;
+};
+
+// Receipts of one message: how many peers got it and when the last one did.
+struct Coverage {
+    uint64_t originId = 0;
+    uint32_t receipts = 0;
+    uint64_t lastLatencyNs = 0;
+};
+
+// Deliveries seen by one I/O thread. Each thread only locks its own entry, so recording is
+// uncontended; the report merges all of them.
+struct DeliveryStats {
+    mutex mtx;
+    uint64_t delivered = 0;
+    LatencyHistogram latencyNs;
+    unordered_map<uint64_t, Coverage> coverage; // messageId -> receipts on this thread
+};
+
+static mutex statsMtx;
+static vector<unique_ptr<DeliveryStats>> allStats;
+static atomic<bool> measuring{false};
+// Coverage is followed for messages whose origin timestamp falls in [coverageFrom, coverageUntil).
+static atomic<uint64_t> coverageFrom{UINT64_MAX};
+static atomic<uint64_t> coverageUntil{UINT64_MAX};
+
+static DeliveryStats &threadStats() {
+    thread_local DeliveryStats *stats = nullptr;
+    if(!stats) {
+        lock_guard<mutex> lock(statsMtx);
+        allStats.push_back(make_unique<DeliveryStats>());
+        stats = allStats.back().get();
+    }
+    return *stats;
+}
+
+static void recordDelivery(const FrameHeader &h) {
+    bool counted = measuring.load(memory_order_relaxed);
+    bool followed = h.originTs >= coverageFrom.load(memory_order_relaxed) &&
+                    h.originTs < coverageUntil.load(memory_order_relaxed);
+    if(!counted && !followed)
+        return;
+    AllocationPause pause; // the harness's own bookkeeping is not the nodes' cost
+    uint64_t now = monotonicNs();
+    uint64_t latency = now > h.originTs ? now - h.originTs : 0;
+    DeliveryStats &stats = threadStats();
+    lock_guard<mutex> lock(stats.mtx);
+    if(counted) {
+        stats.delivered++;
+        stats.latencyNs.record(latency);
+    }
+    if(followed) {
+        Coverage &c = stats.coverage[messageId(h.originId, h.seq)];
+        c.originId = h.originId;
+        c.receipts++;
+        c.lastLatencyNs = max(c.lastLatencyNs, latency);
+    }
+}
+
+// originId -> size of the origin's connected component in the topology's peer-to-peer links,
+// which is as far as gossip can reach (seeds do not relay it).
+static unordered_map<uint64_t, size_t> peerComponents(const MappedTopology &topo) {
+    vector<uint32_t> parent(topo.node_count());
+    iota(parent.begin(), parent.end(), 0);
+    auto root = [&](uint32_t x) {
+        while(parent[x] != x)
+            x = parent[x] = parent[parent[x]];
+        return x;
+    };
+    for(uint32_t id = 0; id < topo.node_count(); id++) {
+        if(topo.type(id) != NodeType::PEER)
+            continue;
+        for(uint32_t nbr : topo.neighbors(id))
+            if(topo.type(nbr) == NodeType::PEER)
+                parent[root(id)] = root(nbr);
+    }
+    vector<size_t> size(topo.node_count());
+    for(uint32_t id = 0; id < topo.node_count(); id++)
+        if(topo.type(id) == NodeType::PEER)
+            size[root(id)]++;
+    unordered_map<uint64_t, size_t> components;
+    for(uint32_t id = 0; id < topo.node_count(); id++) {
+        if(topo.type(id) != NodeType::PEER)
+            continue;
+        string ip, port;
+        splitHostPort(topo.name(id), ip, port);
+        components[makeOriginId(ip, atoi(port.c_str()))] = size[root(id)];
+    }
+    return components;
+}
+
+static double cpuSeconds() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+static bool parseArgs(int argc, char *argv[], HarnessConfig &cfg) {
+    for(int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        auto value = [&](const char *prefix) -> const char * {
+            size_t len = strlen(prefix);
+            return arg.compare(0, len, prefix) == 0 ? arg.c_str() + len : nullptr;
+        };
+        const char *v;
+        if((v = value("--seeds=")))
+            cfg.seeds = max(1, atoi(v));
+        else if((v = value("--peers=")))
+            cfg.peers = max(1, atoi(v));
+        else if((v = value("--neighbors=")))
+            cfg.neighbors = max(1, atoi(v));
+        else if((v = value("--base-port=")))
+            cfg.basePort = atoi(v);
+        else if((v = value("--rate=")))
+            cfg.rate = max(0.0, atof(v));
+        else if((v = value("--warmup=")))
+            cfg.warmupSecs = max(0.0, atof(v));
+        else if((v = value("--duration=")))
+            cfg.durationSecs = max(0.1, atof(v));
+        else if((v = value("--drain=")))
+            cfg.drainSecs = max(0.0, atof(v));
+        else if((v = value("--peer-threads=")))
+            cfg.peerThreads = max(1, atoi(v));
+        else if(arg == "--seed-mode=reactor")
+            cfg.seedMode = SeedMode::Reactor;
+        else if(arg == "--seed-mode=threaded")
+            cfg.seedMode = SeedMode::Threaded;
+        else if((v = value("--seed-threads=")))
+            cfg.seedLoops = max(1, atoi(v));
+        else if((v = value("--seed-replicas=")))
+            cfg.seedReplicas = max(0, atoi(v));
+        else if((v = value("--queue-high-kb=")))
+            cfg.outbound.highWatermark = (size_t)max(1, atoi(v)) << 10;
+        else if((v = value("--queue-low-kb=")))
+            cfg.outbound.lowWatermark = (size_t)max(0, atoi(v)) << 10;
+        else if(arg == "--queue-policy=drop-oldest")
+            cfg.outbound.policy = SlowPolicy::DropOldest;
+        else if(arg == "--queue-policy=disconnect")
+            cfg.outbound.policy = SlowPolicy::Disconnect;
+        else if(arg == "--forward=flood")
+            cfg.rumor.mode = ForwardMode::Flood;
+        else if(arg == "--forward=rumor")
+            cfg.rumor.mode = ForwardMode::Rumor;
+        else if((v = value("--fanout=")))
+            cfg.rumor.fanout = max(1, atoi(v));
+        else if((v = value("--ttl=")))
+            cfg.rumor.ttl = max(1, atoi(v));
+        else if((v = value("--rumor-k=")))
+            cfg.rumor.stopAfterDuplicates = max(1, atoi(v));
+        else if(arg == "--transport=tcp")
+            cfg.transport = Transport::Tcp;
+        else if(arg == "--transport=udp")
+            cfg.transport = Transport::Udp;
+        else if(arg == "--udp-retransmit")
+            cfg.udp.retransmit = true;
+        else if((v = value("--dedup-kb=")))
+            cfg.dedupBytes = (size_t)max(1, atoi(v)) << 10;
+        else if((v = value("--anti-entropy-ms=")))
+            cfg.antiEntropyMs = max(0, atoi(v));
+        else if((v = value("--recent=")))
+            cfg.recentMessages = max(1, atoi(v));
+        else if((v = value("--log=")))
+            cfg.logPath = v;
+        else if((v = value("--topology=")))
+            cfg.topologyPath = v;
+        else {
+            cerr << "Unknown option " << arg << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    HarnessConfig cfg;
+    if(!parseArgs(argc, argv, cfg))
+        return 1;
+
+    // Every peer holds a listener, an epoll fd, an eventfd, its neighbor sockets and one session
+    // per chosen seed; the default soft limit runs out at a few hundred peers.
+    struct rlimit rl;
+    if(getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    LoggerConfig logConfig;
+    logConfig.path = cfg.logPath;
+    logConfig.toStdout = false;
+    logConfig.ringBytes = 64 * 1024; // one ring per peer thread
+    logConfig.policy = OverflowPolicy::Drop;
+    Logger::instance().configure(logConfig);
+
+    vector<pair<string,int>> seeds;
+    vector<TopologyPeer> plan;
+    MappedTopology topology;
+    if(cfg.topologyPath.empty()) {
+        for(int i = 0; i < cfg.seeds; i++)
+            seeds.push_back({"127.0.0.1", cfg.basePort + i});
+    } else {
+        if(!topology.open(cfg.topologyPath) || !planTopology(topology, seeds, plan))
+            return 1;
+        cfg.seeds = seeds.size();
+        cfg.peers = plan.size();
+    }
+    vector<SeedServer*> seedServers;
+    for(auto &s : seeds) {
+        SeedServer *server = new SeedServer(s.first + ":" + to_string(s.second), s.second, cfg.seedMode, cfg.seedLoops);
+        if(cfg.seedReplicas > 0)
+            server->enableSharding(seeds, cfg.seedReplicas);
+        seedServers.push_back(server);
+        thread(&SeedServer::run, server).detach();
+    }
+
+    DedupConfig dedupConfig;
+    dedupConfig.memoryBytes = cfg.dedupBytes;
+    AntiEntropyConfig aeConfig;
+    if(cfg.antiEntropyMs > 0)
+        aeConfig.interval = chrono::milliseconds(cfg.antiEntropyMs);
+    aeConfig.maxMessages = cfg.recentMessages;
+    vector<unique_ptr<PeerNode>> peers;
+    auto setupStart = chrono::steady_clock::now();
+    // Every listener is up before anyone registers, so topology peers can dial all of their
+    // neighbors.
+    for(int i = 0; i < cfg.peers; i++) {
+        string ip = plan.empty() ? "127.0.0.1" : plan[i].ip;
+        string port = plan.empty() ? to_string(cfg.basePort + cfg.seeds + i) : plan[i].port;
+        peers.push_back(make_unique<PeerNode>(ip, port, seeds, dedupConfig, LivenessConfig(), aeConfig));
+        PeerNode &peer = *peers.back();
+        peer.ioThreads = cfg.peerThreads;
+        peer.outboundConfig = cfg.outbound;
+        peer.rumorConfig = cfg.rumor;
+        peer.transport = cfg.transport;
+        peer.udpConfig = cfg.udp;
+        peer.bootstrapConfig.targetNeighbors = cfg.neighbors;
+        peer.onGossipDelivered = recordDelivery;
+        peer.startListener();
+    }
+    for(int i = 0; i < cfg.peers; i++) {
+        PeerNode &peer = *peers[i];
+        // Sequential registration, as peers joining one by one: later peers see the earlier
+        // ones in the seeds' lists and attach preferentially. From a topology file, each peer
+        // dials all of its peer neighbors.
+        if(plan.empty())
+            peer.registerWithSeeds();
+        else
+            peer.registerWithTopology(plan[i].seeds, plan[i].dials);
+        peer.checkLiveness();
+        if(cfg.antiEntropyMs > 0)
+            peer.startAntiEntropy();
+        if((i + 1) % 100 == 0)
+            cout << "started " << (i + 1) << "/" << cfg.peers << " peers" << endl;
+    }
+    double setupSecs = chrono::duration<double>(chrono::steady_clock::now() - setupStart).count();
+    size_t links = 0;
+    for(auto &p : peers)
+        links += p->bootstrap->connected.size();
+    cout << "setup: " << cfg.seeds << " seeds, " << cfg.peers << " peers, " << links << " links in "
+         << setupSecs << " s" << endl;
+
+    // Gossip driver: posts emitGossip() to uniformly random peers to hold the requested rate.
+    atomic<bool> driving{true};
+    atomic<uint64_t> generated{0};
+    thread driver([&] {
+        mt19937 rng(random_device{}());
+        uniform_int_distribution<size_t> pick(0, peers.size() - 1);
+        auto start = chrono::steady_clock::now();
+        uint64_t sent = 0;
+        while(driving.load()) {
+            double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            for(uint64_t due = (uint64_t)(elapsed * cfg.rate); sent < due; sent++) {
+                PeerNode *p = peers[pick(rng)].get();
+                p->loop.post([p] { p->emitGossip(); });
+                if(measuring.load(memory_order_relaxed))
+                    generated++;
+            }
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    });
+
+    this_thread::sleep_for(chrono::duration<double>(cfg.warmupSecs));
+    double cpuStart = cpuSeconds();
+    uint64_t allocStart = allocationCount();
+    uint64_t framesStart = FramePool::instance().acquired(), missesStart = FramePool::instance().misses();
+    auto windowStart = chrono::steady_clock::now();
+    coverageFrom = monotonicNs();
+    coverageUntil = UINT64_MAX;
+    measuring = true;
+    this_thread::sleep_for(chrono::duration<double>(cfg.durationSecs));
+    measuring = false;
+    coverageUntil = monotonicNs();
+    double windowSecs = chrono::duration<double>(chrono::steady_clock::now() - windowStart).count();
+    double cpuUsed = cpuSeconds() - cpuStart;
+    uint64_t allocations = allocationCount() - allocStart;
+    uint64_t framesAcquired = FramePool::instance().acquired() - framesStart;
+    uint64_t frameMisses = FramePool::instance().misses() - missesStart;
+    driving = false;
+    driver.join();
+    this_thread::sleep_for(chrono::duration<double>(cfg.drainSecs));
+
+    uint64_t delivered = 0;
+    LatencyHistogram latency;
+    unordered_map<uint64_t, Coverage> coverage;
+    {
+        lock_guard<mutex> lock(statsMtx);
+        for(auto &s : allStats) {
+            lock_guard<mutex> statsLock(s->mtx);
+            delivered += s->delivered;
+            latency.merge(s->latencyNs);
+            for(auto &entry : s->coverage) {
+                Coverage &c = coverage[entry.first];
+                c.originId = entry.second.originId;
+                c.receipts += entry.second.receipts;
+                c.lastLatencyNs = max(c.lastLatencyNs, entry.second.lastLatencyNs);
+            }
+        }
+    }
+    // Time until the last peer a message reaches has it; "full" means every other peer did.
+    LatencyHistogram lastReceipt, reach;
+    size_t full = 0;
+    for(auto &entry : coverage) {
+        lastReceipt.record(entry.second.lastLatencyNs);
+        reach.record(entry.second.receipts);
+        if(entry.second.receipts + 1 >= peers.size())
+            full++;
+    }
+    PropagationStats hops;
+    QueueDelays queueDelays;
+    uint64_t framesSent = 0, floodFrames = 0, bytesSent = 0, floodBytes = 0;
+    for(auto &p : peers) {
+        hops.merge(p->propagationStats());
+        queueDelays.merge(p->queueDelays());
+        framesSent += p->forwardCounters.framesSent;
+        floodFrames += p->forwardCounters.floodFrames;
+        bytesSent += p->forwardCounters.bytesSent;
+        floodBytes += p->forwardCounters.floodBytes;
+    }
+    uint64_t gen = generated.load();
+    cout << "window: " << windowSecs << " s" << endl;
+    cout << "generated: " << gen << " msgs (" << gen / windowSecs << " msgs/s)" << endl;
+    cout << "delivered: " << delivered << " msgs (" << delivered / windowSecs << " msgs/s, "
+         << (gen ? (double)delivered / gen : 0.0) << " receipts per generated msg)" << endl;
+    cout << "cpu: " << cpuUsed << " s (" << 100.0 * cpuUsed / windowSecs << "% of one core, "
+         << thread::hardware_concurrency() << " cores, " << (delivered ? 1e6 * cpuUsed / delivered : 0.0)
+         << " us per delivery)" << endl;
+    cout << "heap allocations (window): " << allocations << " (" << (delivered ? (double)allocations / delivered : 0.0)
+         << " per delivery, " << allocations / windowSecs << "/s); frame pool misses " << frameMisses << " of "
+         << framesAcquired << " acquired" << endl;
+    cout << "frame pool (since start): " << FramePool::instance().summary() << endl;
+    cout << "latency: " << latency.summary(1e3, "us") << endl;
+    cout << "hops (all receipts since start): " << hops.hops().summary() << endl;
+    cout << "send queue delay (all frames since start): " << queueDelays.summary() << endl;
+    cout << "coverage: " << coverage.size() << " msgs followed, peers reached " << reach.summary() << " of "
+         << peers.size() - 1 << ", " << full << " reached all" << endl;
+    if(!plan.empty()) {
+        // Coverage against what the file allows: every other peer of the origin's component.
+        unordered_map<uint64_t, size_t> components = peerComponents(topology);
+        size_t whole = 0;
+        for(auto &entry : coverage) {
+            auto it = components.find(entry.second.originId);
+            if(it != components.end() && entry.second.receipts + 1 >= it->second)
+                whole++;
+        }
+        size_t largest = 0;
+        for(auto &entry : components)
+            largest = max(largest, entry.second);
+        cout << "topology coverage: " << whole << " of " << coverage.size()
+             << " msgs reached their origin's whole component (largest component " << largest << " of "
+             << peers.size() << " peers)" << endl;
+    }
+    cout << "time to last receipt: " << lastReceipt.summary(1e3, "us") << endl;
+    cout << "gossip frames sent (since start): " << framesSent << " of " << floodFrames << " a flood would send ("
+         << bytesSent << " of " << floodBytes << " bytes, "
+         << (floodBytes ? 100.0 * (floodBytes - bytesSent) / floodBytes : 0.0) << "% saved)" << endl;
+    if(cfg.transport == Transport::Udp) {
+        uint64_t datagramsSent = 0, sendCalls = 0, datagramsReceived = 0, recvCalls = 0, dropped = 0, retransmits = 0,
+                 gaveUp = 0;
+        for(auto &p : peers) {
+            datagramsSent += p->udp.datagramsSent();
+            sendCalls += p->udp.sendCalls();
+            datagramsReceived += p->udp.datagramsReceived();
+            recvCalls += p->udp.recvCalls();
+            dropped += p->udp.dropped();
+            retransmits += p->udpCounters.retransmits;
+            gaveUp += p->udpCounters.gaveUp;
+        }
+        cout << "udp (since start): " << datagramsSent << " datagrams in " << sendCalls << " sendmmsg, "
+             << datagramsReceived << " in " << recvCalls << " recvmmsg, " << dropped << " dropped, " << retransmits
+             << " retransmits, " << gaveUp << " unacknowledged" << endl;
+    }
+    // Membership entries each seed holds; sharding stores about replicas/seeds of them per seed.
+    size_t entries = 0;
+    cout << "seed members:";
+    for(SeedServer *server : seedServers) {
+        cout << " " << server->members.size();
+        entries += server->members.size();
+    }
+    cout << " (" << (double)entries / peers.size() << " entries per peer)" << endl;
+    if(cfg.seedReplicas > 0)
+        for(SeedServer *server : seedServers)
+            cout << server->clusterSummary() << endl;
+    cout << "log: " << Logger::instance().bytesWritten() << " bytes written, " << Logger::instance().dropped()
+         << " lines dropped" << endl;
+
+    // Seed servers block forever in accept()/epoll_wait(), and tearing down thousands of peers
+    // gains nothing, so flush the log and leave.
+    Logger::instance().flush();
+    cout.flush();
+    _exit(0);
+}
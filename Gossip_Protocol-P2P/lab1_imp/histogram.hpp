@@ -0,0 +1,110 @@
+// histogram.hpp
+/*
+  LatencyHistogram: fixed-size log-linear histogram for latencies and small counts.
+
+  Values are bucketed by power of two with 8 linear sub-buckets per octave, so any percentile
+  is reported within 12.5% of the true value while the histogram stays a flat array of
+  counters (no allocation after construction, merge is element-wise addition).
+*/
+#pragma once
+#include <array>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 3;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    LatencyHistogram() { clear(); }
+
+    void clear() {
+        counts_.fill(0);
+        count_ = 0;
+        sum_ = 0;
+        min_ = UINT64_MAX;
+        max_ = 0;
+    }
+
+    void record(uint64_t value) {
+        counts_[bucketOf(value)]++;
+        count_++;
+        sum_ += value;
+        if (value < min_)
+            min_ = value;
+        if (value > max_)
+            max_ = value;
+    }
+
+    void merge(const LatencyHistogram &o) {
+        for (int i = 0; i < BUCKETS; i++)
+            counts_[i] += o.counts_[i];
+        count_ += o.count_;
+        sum_ += o.sum_;
+        if (o.min_ < min_)
+            min_ = o.min_;
+        if (o.max_ > max_)
+            max_ = o.max_;
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t min() const { return count_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ ? (double)sum_ / count_ : 0.0; }
+
+    // Upper bound of the bucket holding the p-th percentile (0 < p <= 100).
+    uint64_t percentile(double p) const {
+        if (count_ == 0)
+            return 0;
+        uint64_t rank = (uint64_t)(p / 100.0 * count_ + 0.5);
+        if (rank == 0)
+            rank = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += counts_[i];
+            if (seen >= rank) {
+                uint64_t upper = bucketUpper(i);
+                return upper < max_ ? upper : max_;
+            }
+        }
+        return max_;
+    }
+
+    // "n=<count> mean=<v> p50=<v> p90=<v> p99=<v> max=<v>" with values divided by scale.
+    std::string summary(double scale = 1.0, const char *unit = "") const {
+        std::ostringstream oss;
+        oss << "n=" << count_ << " mean=" << mean() / scale << unit
+            << " p50=" << percentile(50) / scale << unit
+            << " p90=" << percentile(90) / scale << unit
+            << " p99=" << percentile(99) / scale << unit
+            << " max=" << max() / scale << unit;
+        return oss.str();
+    }
+
+private:
+    std::array<uint64_t, BUCKETS> counts_;
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t min_;
+    uint64_t max_;
+
+    static int bucketOf(uint64_t v) {
+        if (v < (uint64_t)SUB_BUCKETS)
+            return (int)v;
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - SUB_BITS;
+        int sub = (int)((v >> shift) & (SUB_BUCKETS - 1));
+        return (shift + 1) * SUB_BUCKETS + sub;
+    }
+
+    static uint64_t bucketUpper(int b) {
+        if (b < SUB_BUCKETS)
+            return (uint64_t)b;
+        int shift = b / SUB_BUCKETS - 1;
+        uint64_t sub = (uint64_t)(b % SUB_BUCKETS);
+        uint64_t lower = ((uint64_t)SUB_BUCKETS + sub) << shift;
+        return lower + (1ULL << shift) - 1;
+    }
+};
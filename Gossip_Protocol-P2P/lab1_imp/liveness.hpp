@@ -0,0 +1,222 @@
+// liveness.hpp
+/*
+  LivenessEngine: asynchronous PING/PONG failure detector running on an EventLoop.
+
+    • Every neighbor is probed once per probeInterval on its own timer; first probes are
+      spread uniformly over one interval so a peer never pings all neighbors at once.
+    • Each PING carries a random nonce that the PONG echoes. PONGs are matched whenever they
+      arrive; a PONG with a stale nonce is counted but ignored.
+    • Per neighbor, RTT is tracked as an EWMA, as RFC 6298 SRTT/RTTVAR, and as a histogram
+      for percentiles. The probe timeout is SRTT + 4*RTTVAR (clamped to [minTimeout,
+      maxTimeout]; initialTimeout before the first sample).
+    • A probe that gets no PONG within its timeout is a failure unless something else was
+      heard from the neighbor since it was sent: a late PONG or, through lastHeard, any other
+      frame. A failed probe is retried at once with the timeout doubled; after maxFailures in
+      a row onDead(neighbor) is called, (2^maxFailures - 1) timeouts after the first probe, a
+      few seconds rather than several probe intervals. PONGs travel on the control lane, so
+      a busy neighbor answers in time; one that was heard from waits for its next tick.
+
+  All methods must be called on the loop thread.
+*/
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include "event_loop.hpp"
+#include "histogram.hpp"
+
+struct LivenessConfig {
+    std::chrono::milliseconds probeInterval{13000};
+    std::chrono::milliseconds initialTimeout{1000};
+    std::chrono::milliseconds minTimeout{500}; // loaded loops delay PONGs by tens of ms
+    std::chrono::milliseconds maxTimeout{10000};
+    int maxFailures = 3;         // consecutive unanswered probes before a neighbor is dead
+    double ewmaAlpha = 0.25;     // EWMA reacts faster than SRTT (gain 1/8)
+};
+
+struct NeighborLiveness {
+    std::string addr;
+    bool hasSample = false;
+    double ewmaUs = 0;           // exponentially weighted moving average RTT
+    double srttUs = 0;           // RFC 6298 smoothed RTT
+    double rttvarUs = 0;         // RFC 6298 RTT variation
+    int failures = 0;            // consecutive timeouts with nothing heard since their probe
+    uint64_t probesSent = 0;
+    uint64_t pongs = 0;
+    uint64_t timeouts = 0;
+    uint64_t latePongs = 0;
+    LatencyHistogram rttUs;
+    uint64_t outstandingNonce = 0; // 0: no probe in flight
+    EventLoop::Clock::time_point sentAt;
+    EventLoop::Clock::time_point lastPong; // late ones included; or when probing began
+    EventLoop::TimerId probeTimer = 0;
+    EventLoop::TimerId timeoutTimer = 0;
+};
+
+class LivenessEngine {
+public:
+    // Sends a PING with the nonce; returns false if the neighbor has no usable connection.
+    using SendProbe = std::function<bool(const std::string &nbr, uint64_t nonce)>;
+    using OnDead = std::function<void(const std::string &nbr)>;
+    // When any frame last arrived from the neighbor; a default time_point if never.
+    using LastHeard = std::function<EventLoop::Clock::time_point(const std::string &nbr)>;
+
+    LivenessEngine(EventLoop &loop, SendProbe send, OnDead onDead, LastHeard lastHeard,
+                   const LivenessConfig &cfg = LivenessConfig())
+        : loop_(loop), send_(std::move(send)), onDead_(std::move(onDead)), lastHeard_(std::move(lastHeard)), cfg_(cfg),
+          rng_(std::random_device{}()) {
+        nonceBase_ = rng_();
+    }
+
+    // Begins probing every known neighbor; neighbors added later are probed right away.
+    void start() {
+        if (started_)
+            return;
+        started_ = true;
+        for (auto &entry : neighbors_)
+            scheduleProbes(*entry.second);
+    }
+
+    void addNeighbor(const std::string &nbr) {
+        if (neighbors_.count(nbr))
+            return;
+        auto state = std::make_unique<NeighborLiveness>();
+        state->addr = nbr;
+        NeighborLiveness &n = *state;
+        neighbors_[nbr] = std::move(state);
+        if (started_)
+            scheduleProbes(n);
+    }
+
+    void removeNeighbor(const std::string &nbr) {
+        auto it = neighbors_.find(nbr);
+        if (it == neighbors_.end())
+            return;
+        loop_.cancel(it->second->probeTimer);
+        loop_.cancel(it->second->timeoutTimer);
+        neighbors_.erase(it);
+    }
+
+    void onPong(const std::string &nbr, uint64_t nonce) {
+        auto it = neighbors_.find(nbr);
+        if (it == neighbors_.end())
+            return;
+        NeighborLiveness &n = *it->second;
+        if (nonce == 0 || nonce != n.outstandingNonce) {
+            n.latePongs++;
+            if (nonce != 0)
+                n.lastPong = EventLoop::Clock::now(); // still proves the neighbor is alive
+            return;
+        }
+        double rtt = std::chrono::duration<double, std::micro>(EventLoop::Clock::now() - n.sentAt).count();
+        loop_.cancel(n.timeoutTimer);
+        n.outstandingNonce = 0;
+        n.failures = 0;
+        n.lastPong = EventLoop::Clock::now();
+        n.pongs++;
+        n.rttUs.record((uint64_t)rtt);
+        if (!n.hasSample) {
+            n.hasSample = true;
+            n.ewmaUs = n.srttUs = rtt;
+            n.rttvarUs = rtt / 2;
+        } else {
+            n.ewmaUs += cfg_.ewmaAlpha * (rtt - n.ewmaUs);
+            n.rttvarUs = 0.75 * n.rttvarUs + 0.25 * std::abs(n.srttUs - rtt);
+            n.srttUs = 0.875 * n.srttUs + 0.125 * rtt;
+        }
+    }
+
+    // Current probe timeout for a neighbor, before backoff.
+    std::chrono::microseconds timeoutFor(const NeighborLiveness &n) const {
+        double us = n.hasSample ? n.srttUs + std::max(1000.0, 4 * n.rttvarUs)
+                                : std::chrono::duration<double, std::micro>(cfg_.initialTimeout).count();
+        double lo = std::chrono::duration<double, std::micro>(cfg_.minTimeout).count();
+        double hi = std::chrono::duration<double, std::micro>(cfg_.maxTimeout).count();
+        return std::chrono::microseconds((int64_t)std::min(hi, std::max(lo, us)));
+    }
+
+    const NeighborLiveness *stats(const std::string &nbr) const {
+        auto it = neighbors_.find(nbr);
+        return it == neighbors_.end() ? nullptr : it->second.get();
+    }
+
+    // One line per neighbor: RTT EWMA/SRTT, percentiles, current timeout and counters.
+    std::string summary() const {
+        std::ostringstream oss;
+        for (auto &entry : neighbors_) {
+            const NeighborLiveness &n = *entry.second;
+            oss << "liveness " << n.addr << " ewma_us=" << (uint64_t)n.ewmaUs
+                << " srtt_us=" << (uint64_t)n.srttUs << " rto_us=" << timeoutFor(n).count()
+                << " rtt_us[" << n.rttUs.summary() << "]"
+                << " probes=" << n.probesSent << " pongs=" << n.pongs << " timeouts=" << n.timeouts
+                << " late=" << n.latePongs << "\n";
+        }
+        return oss.str();
+    }
+
+private:
+    EventLoop &loop_;
+    SendProbe send_;
+    OnDead onDead_;
+    LastHeard lastHeard_;
+    LivenessConfig cfg_;
+    std::mt19937_64 rng_;
+    uint64_t nonceBase_;
+    uint64_t nonceCounter_ = 0;
+    bool started_ = false;
+    std::unordered_map<std::string, std::unique_ptr<NeighborLiveness>> neighbors_;
+
+    uint64_t nextNonce() {
+        uint64_t nonce = nonceBase_ ^ (++nonceCounter_ * 0x9e3779b97f4a7c15ULL);
+        return nonce == 0 ? 1 : nonce;
+    }
+
+    void scheduleProbes(NeighborLiveness &n) {
+        n.lastPong = EventLoop::Clock::now();
+        std::uniform_int_distribution<int64_t> jitter(0, cfg_.probeInterval.count());
+        NeighborLiveness *np = &n;
+        n.probeTimer = loop_.runEvery(std::chrono::milliseconds(jitter(rng_)), cfg_.probeInterval,
+                                      [this, np] {
+                                          if (np->outstandingNonce == 0)
+                                              probe(*np);
+                                      });
+    }
+
+    // Sends a probe whose timeout is the RTO doubled once per consecutive failure so far. A
+    // probe that could not be sent times out like a lost one.
+    void probe(NeighborLiveness &n) {
+        n.outstandingNonce = nextNonce();
+        n.sentAt = EventLoop::Clock::now();
+        n.probesSent++;
+        send_(n.addr, n.outstandingNonce);
+        auto rto = std::min<std::chrono::microseconds>(timeoutFor(n) * (1 << std::min(n.failures, 10)),
+                                                        cfg_.maxTimeout);
+        NeighborLiveness *np = &n; // removing the neighbor cancels the timer, as for probeTimer
+        n.timeoutTimer = loop_.runAfter(rto, [this, np] { timedOut(*np); });
+    }
+
+    // The probe got no PONG within its timeout. If the neighbor was heard from since the probe
+    // went out it is alive and the next tick probes again; otherwise the probe is retried now
+    // with a doubled timeout, until maxFailures.
+    void timedOut(NeighborLiveness &n) {
+        n.outstandingNonce = 0;
+        n.timeouts++;
+        if (std::max(n.lastPong, lastHeard_(n.addr)) >= n.sentAt) {
+            n.failures = 0;
+            return;
+        }
+        if (++n.failures >= cfg_.maxFailures) {
+            std::string nbr = n.addr;
+            onDead_(nbr); // may remove the neighbor; n must not be used afterwards
+            return;
+        }
+        probe(n);
+    }
+};
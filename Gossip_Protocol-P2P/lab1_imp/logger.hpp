@@ -0,0 +1,288 @@
+// logger.hpp
+/*
+  Asynchronous, batched logging for peers and seeds.
+
+  Logger::instance().log(line) appends "line\n" to a lock-free single-producer/single-consumer
+  byte ring owned by the calling thread (created on first use). A background writer wakes every
+  flushInterval (or sooner when a ring is filling up), drains all rings into one buffer and
+  writes it to stdout and outputfile.txt with one write() per sink, so no logging thread ever
+  waits on disk I/O or holds a lock while doing it.
+
+  Lines from one thread stay in order; lines from different threads are ordered per batch.
+  When a ring is full the OverflowPolicy decides: Drop discards the line (and counts it),
+  Block waits for the writer to make room.
+
+  The writer thread starts with the first log(). From then on the configuration is fixed:
+  configure() refuses, so log() and the writer read it without a lock.
+*/
+#pragma once
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+enum class OverflowPolicy { Drop, Block };
+
+struct LoggerConfig {
+    std::string path = "outputfile.txt";
+    bool toStdout = true;
+    std::chrono::milliseconds flushInterval{50};
+    size_t ringBytes = 256 * 1024;   // per producing thread, rounded up to a power of two
+    OverflowPolicy policy = OverflowPolicy::Block;
+};
+
+class Logger {
+public:
+    static Logger &instance() {
+        static Logger logger;
+        return logger;
+    }
+
+    // Applies cfg. Returns false, leaving the configuration unchanged, once anything has been
+    // logged.
+    bool configure(const LoggerConfig &cfg) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (started_) {
+            fprintf(stderr, "Logger: configure() after the first log line is ignored\n");
+            return false;
+        }
+        cfg_ = cfg;
+        return true;
+    }
+
+    void log(std::string_view line) {
+        LogRing *ring = localRing();
+        size_t need = sizeof(uint32_t) + line.size() + 1;
+        if (need > ring->capacity / 2) {
+            line = line.substr(0, ring->capacity / 2 - sizeof(uint32_t) - 1);
+            need = sizeof(uint32_t) + line.size() + 1;
+        }
+        while (!ring->tryPush(line, need)) {
+            if (cfg_.policy == OverflowPolicy::Drop) {
+                dropped_++;
+                return;
+            }
+            wake();
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        // Wake the writer early once a ring is half full.
+        if (ring->used() > ring->capacity / 2)
+            wake();
+    }
+
+    // Blocks until everything logged so far has been written.
+    void flush() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (!started_)
+                return;
+        }
+        uint64_t target = batches_.load() + 2;
+        wake();
+        while (batches_.load() < target && running_)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    uint64_t dropped() const { return dropped_.load(); }
+    uint64_t bytesWritten() const { return bytesWritten_.load(); }
+    uint64_t writes() const { return writes_.load(); }
+
+    ~Logger() {
+        running_ = false;
+        wake();
+        if (writer_.joinable())
+            writer_.join();
+        if (fileFd_ >= 0)
+            close(fileFd_);
+    }
+
+private:
+    // SPSC ring of [uint32 length][bytes + '\n'] records. head/tail only ever increase.
+    struct LogRing {
+        std::vector<char> data;
+        size_t capacity;
+        std::atomic<size_t> head{0}; // consumer position
+        std::atomic<size_t> tail{0}; // producer position
+        std::atomic<bool> closed{false};
+
+        explicit LogRing(size_t bytes) {
+            capacity = 1024;
+            while (capacity < bytes)
+                capacity *= 2;
+            data.resize(capacity);
+        }
+
+        size_t used() const { return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); }
+
+        void copyIn(size_t pos, const char *src, size_t n) {
+            size_t off = pos & (capacity - 1);
+            size_t first = std::min(n, capacity - off);
+            memcpy(data.data() + off, src, first);
+            memcpy(data.data(), src + first, n - first);
+        }
+
+        void copyOut(size_t pos, char *dst, size_t n) const {
+            size_t off = pos & (capacity - 1);
+            size_t first = std::min(n, capacity - off);
+            memcpy(dst, data.data() + off, first);
+            memcpy(dst + first, data.data(), n - first);
+        }
+
+        bool tryPush(std::string_view line, size_t need) {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (capacity - (t - head.load(std::memory_order_acquire)) < need)
+                return false;
+            uint32_t len = (uint32_t)line.size() + 1;
+            copyIn(t, (const char *)&len, sizeof(len));
+            copyIn(t + sizeof(len), line.data(), line.size());
+            copyIn(t + sizeof(len) + line.size(), "\n", 1);
+            tail.store(t + need, std::memory_order_release);
+            return true;
+        }
+
+        // Appends every complete record to out.
+        void drainInto(std::string &out) {
+            size_t h = head.load(std::memory_order_relaxed);
+            size_t t = tail.load(std::memory_order_acquire);
+            while (h < t) {
+                uint32_t len;
+                copyOut(h, (char *)&len, sizeof(len));
+                size_t at = out.size();
+                out.resize(at + len);
+                copyOut(h + sizeof(len), &out[at], len);
+                h += sizeof(len) + len;
+            }
+            head.store(h, std::memory_order_release);
+        }
+    };
+
+    // Marks the thread's ring closed when the thread exits; the writer frees it once drained.
+    struct RingHandle {
+        std::shared_ptr<LogRing> ring;
+        ~RingHandle() {
+            if (ring)
+                ring->closed = true;
+        }
+    };
+
+    LoggerConfig cfg_;        // written only before started_
+    std::mutex mtx_;          // guards rings_ and started_; log() takes it once per thread
+    std::vector<std::shared_ptr<LogRing>> rings_;
+    bool started_ = false;
+    int fileFd_ = -1;         // writer thread only; opened on the first non-empty batch
+    bool openFailed_ = false;
+    std::atomic<bool> running_{true};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> bytesWritten_{0};
+    std::atomic<uint64_t> writes_{0};
+    std::atomic<uint64_t> batches_{0};
+    std::mutex wakeMtx_;
+    std::condition_variable wakeCv_;
+    bool wakeRequested_ = false;
+    std::thread writer_;
+
+    Logger() = default;
+
+    void openFile() {
+        fileFd_ = open(cfg_.path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fileFd_ < 0) {
+            perror("Error opening log file");
+            openFailed_ = true;
+        }
+    }
+
+    LogRing *localRing() {
+        thread_local RingHandle handle;
+        if (!handle.ring) {
+            // Taking mtx_ also orders this thread's later reads of cfg_ after configure().
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (!started_) {
+                started_ = true;
+                writer_ = std::thread(&Logger::writerLoop, this);
+            }
+            handle.ring = std::make_shared<LogRing>(cfg_.ringBytes);
+            rings_.push_back(handle.ring);
+        }
+        return handle.ring.get();
+    }
+
+    void wake() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMtx_);
+            wakeRequested_ = true;
+        }
+        wakeCv_.notify_one();
+    }
+
+    static void writeAll(int fd, const std::string &buf) {
+        size_t off = 0;
+        while (off < buf.size()) {
+            ssize_t n = write(fd, buf.data() + off, buf.size() - off);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                return;
+            }
+            off += n;
+        }
+    }
+
+    void writerLoop() {
+        std::string batch;
+        batch.reserve(1 << 20);
+        while (true) {
+            bool stopping = !running_;
+            {
+                std::unique_lock<std::mutex> lock(wakeMtx_);
+                if (!stopping)
+                    wakeCv_.wait_for(lock, cfg_.flushInterval, [this] { return wakeRequested_ || !running_; });
+                wakeRequested_ = false;
+            }
+            batch.clear();
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                for (size_t i = 0; i < rings_.size();) {
+                    rings_[i]->drainInto(batch);
+                    if (rings_[i]->closed && rings_[i]->used() == 0) {
+                        rings_[i] = rings_.back();
+                        rings_.pop_back();
+                    } else {
+                        i++;
+                    }
+                }
+            }
+            // Disk and terminal writes happen without mtx_, so a thread creating its ring
+            // never waits on them.
+            if (!batch.empty()) {
+                if (fileFd_ < 0 && !openFailed_)
+                    openFile();
+                if (cfg_.toStdout)
+                    writeAll(STDOUT_FILENO, batch);
+                if (fileFd_ >= 0)
+                    writeAll(fileFd_, batch);
+                bytesWritten_ += batch.size();
+                writes_++;
+            }
+            batches_++;
+            if (stopping)
+                return;
+        }
+    }
+};
+
+// Convenience wrapper used by PeerNode and SeedServer.
+inline void logLine(std::string_view line) {
+    Logger::instance().log(line);
+}
@@ -5,6 +5,8 @@
 #include <vector>
 #include <thread>
 #include <cstdlib>
+#include <csignal>
+#include <sys/resource.h>
 #include "seed.cpp"
 #include "peer.cpp"
 using namespace std;
@@ -32,43 +34,199 @@ vector<pair<string,int>> readSeedConfig(const string &filename) {
     return seeds;
 }
 
-int main() {
+// Command-line options:
+//   --seed-mode=threaded|reactor   connection model for the seed servers (default: threaded)
+//   --seed-threads=N               event loops per seed in reactor mode (default: #cores)
+//   --seed-replicas=N              shard membership: each peer is stored on N seeds of a
+//                                  consistent-hash ring (default: 0, every seed stores every peer)
+//   --seed-state-dir=DIR           keep each seed's membership in a write-ahead log and snapshot
+//                                  under DIR and restore it on restart (default: off)
+//   --seed-sync-writes             fdatasync() every write-ahead log record
+//   --log-flush-ms=N               interval of the background log writer (default: 50)
+//   --log-policy=block|drop        what a full per-thread log buffer does (default: block)
+//   --peer-threads=N               event loops serving each peer's connections (default: 1)
+//   --queue-high-kb=N              per-connection send queue high watermark (default: 1024)
+//   --queue-low-kb=N               drop-oldest trims a full queue down to this (default: 256)
+//   --queue-policy=drop-oldest|disconnect
+//                                  what a neighbor over the high watermark gets (default: drop-oldest)
+//   --forward=flood|rumor          gossip forwarding (default: flood)
+//   --fanout=N, --ttl=N, --rumor-k=N
+//                                  rumor mode: initial fanout, hop limit, duplicates that stop a rumor
+//   --transport=tcp|udp            neighbor traffic over a TCP connection per neighbor, or one
+//                                  batched UDP socket per peer (default: tcp)
+//   --udp-retransmit               over UDP, acknowledge gossip and resend what is not acknowledged
+//   --topology=FILE                start the seeds and peers of a topology file (nb --out=FILE)
+//                                  instead of config.txt and two peers, each peer wired to exactly
+//                                  its neighbors in the file
+// Send SIGUSR1 (kill -USR1 <pid>) to log each seed's connection and memory statistics and each
+// peer's propagation latency/hop histograms, anti-entropy counters, liveness RTTs and send-queue
+// depths.
+int main(int argc, char *argv[]) {
+    SeedMode seedMode = SeedMode::Threaded;
+    int seedLoops = 0;
+    int seedReplicas = 0;
+    JournalConfig journalConfig;
+    bool seedJournal = false;
+    LoggerConfig logConfig;
+    int peerThreads = 1;
+    OutboundConfig outboundConfig;
+    RumorConfig rumorConfig;
+    Transport transport = Transport::Tcp;
+    UdpConfig udpConfig;
+    string topologyPath;
+    for(int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if(arg == "--seed-mode=reactor")
+            seedMode = SeedMode::Reactor;
+        else if(arg == "--seed-mode=threaded")
+            seedMode = SeedMode::Threaded;
+        else if(arg.rfind("--seed-threads=", 0) == 0)
+            seedLoops = atoi(arg.c_str() + 15);
+        else if(arg.rfind("--seed-replicas=", 0) == 0)
+            seedReplicas = max(0, atoi(arg.c_str() + 16));
+        else if(arg.rfind("--seed-state-dir=", 0) == 0) {
+            journalConfig.dir = arg.substr(17);
+            seedJournal = true;
+        }
+        else if(arg == "--seed-sync-writes")
+            journalConfig.syncWrites = true;
+        else if(arg.rfind("--log-flush-ms=", 0) == 0)
+            logConfig.flushInterval = chrono::milliseconds(atoi(arg.c_str() + 15));
+        else if(arg == "--log-policy=drop")
+            logConfig.policy = OverflowPolicy::Drop;
+        else if(arg == "--log-policy=block")
+            logConfig.policy = OverflowPolicy::Block;
+        else if(arg.rfind("--peer-threads=", 0) == 0)
+            peerThreads = max(1, atoi(arg.c_str() + 15));
+        else if(arg.rfind("--queue-high-kb=", 0) == 0)
+            outboundConfig.highWatermark = (size_t)max(1, atoi(arg.c_str() + 16)) << 10;
+        else if(arg.rfind("--queue-low-kb=", 0) == 0)
+            outboundConfig.lowWatermark = (size_t)max(0, atoi(arg.c_str() + 15)) << 10;
+        else if(arg == "--queue-policy=drop-oldest")
+            outboundConfig.policy = SlowPolicy::DropOldest;
+        else if(arg == "--queue-policy=disconnect")
+            outboundConfig.policy = SlowPolicy::Disconnect;
+        else if(arg == "--forward=flood")
+            rumorConfig.mode = ForwardMode::Flood;
+        else if(arg == "--forward=rumor")
+            rumorConfig.mode = ForwardMode::Rumor;
+        else if(arg.rfind("--fanout=", 0) == 0)
+            rumorConfig.fanout = max(1, atoi(arg.c_str() + 9));
+        else if(arg.rfind("--ttl=", 0) == 0)
+            rumorConfig.ttl = max(1, atoi(arg.c_str() + 6));
+        else if(arg.rfind("--rumor-k=", 0) == 0)
+            rumorConfig.stopAfterDuplicates = max(1, atoi(arg.c_str() + 10));
+        else if(arg == "--transport=tcp")
+            transport = Transport::Tcp;
+        else if(arg == "--transport=udp")
+            transport = Transport::Udp;
+        else if(arg == "--udp-retransmit")
+            udpConfig.retransmit = true;
+        else if(arg.rfind("--topology=", 0) == 0)
+            topologyPath = arg.substr(11);
+        else {
+            cerr << "Unknown option " << arg << endl;
+            return 1;
+        }
+    }
+
+    // SIGUSR1 is handled synchronously by the main thread below; block it before any other
+    // thread exists so every thread inherits the mask.
+    sigset_t dumpSignals;
+    sigemptyset(&dumpSignals);
+    sigaddset(&dumpSignals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &dumpSignals, nullptr);
+
     // Clear previous output.
     ofstream ofs("outputfile.txt", ios::out);
     ofs.close();
+    Logger::instance().configure(logConfig);
 
-    // Read seeds from config.txt.
-    vector<pair<string,int>> seeds = readSeedConfig("config.txt");
+    // Read seeds from config.txt, or seeds and peers from the topology file.
+    vector<pair<string,int>> seeds;
+    vector<TopologyPeer> plan;
+    MappedTopology topology;
+    bool fromTopology = !topologyPath.empty();
+    if(!fromTopology)
+        seeds = readSeedConfig("config.txt");
+    else if(!topology.open(topologyPath) || !planTopology(topology, seeds, plan))
+        return 1;
+    if(fromTopology) {
+        // Every peer holds a listener, an epoll fd, an eventfd and its neighbor sockets.
+        struct rlimit rl;
+        if(getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+            rl.rlim_cur = rl.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &rl);
+        }
+    }
 
     // Start seed servers (one per seed from config.txt).
     vector<thread> seedThreads;
     vector<SeedServer*> seedServers;
     for(auto &s : seeds) {
-        SeedServer *server = new SeedServer(s.first + ":" + to_string(s.second), s.second);
+        SeedServer *server = new SeedServer(s.first + ":" + to_string(s.second), s.second, seedMode, seedLoops);
+        if(seedJournal)
+            server->enableJournal(journalConfig);
+        if(seedReplicas > 0)
+            server->enableSharding(seeds, seedReplicas);
         seedServers.push_back(server);
         seedThreads.push_back(thread(&SeedServer::run, server));
     }
 
     // For simulation, create multiple PeerNode instances.
     // In a real deployment, these would be launched separately (possibly on different machines).
-    PeerNode peer1("127.0.0.1", "5000", seeds);
-    PeerNode peer2("127.0.0.1", "5001", seeds);
+    vector<unique_ptr<PeerNode>> peers;
+    if(!fromTopology) {
+        peers.push_back(make_unique<PeerNode>("127.0.0.1", "5000", seeds));
+        peers.push_back(make_unique<PeerNode>("127.0.0.1", "5001", seeds));
+    }
+    for(auto &p : plan)
+        peers.push_back(make_unique<PeerNode>(p.ip, p.port, seeds));
+    for(auto &peer : peers) {
+        peer->ioThreads = peerThreads;
+        peer->outboundConfig = outboundConfig;
+        peer->rumorConfig = rumorConfig;
+        peer->transport = transport;
+        peer->udpConfig = udpConfig;
+    }
     // Start each peer's listener.
-    peer1.startListener();
-    peer2.startListener();
-    // Register with seeds and discover neighbors.
-    peer1.registerWithSeeds();
-    peer2.registerWithSeeds();
-    // Start gossip generation and liveness checking for each peer.
-    thread t1(&PeerNode::generateGossip, &peer1);
-    thread t2(&PeerNode::checkLiveness, &peer1);
-    thread t3(&PeerNode::generateGossip, &peer2);
-    thread t4(&PeerNode::checkLiveness, &peer2);
-    t1.join();
-    t3.join();
-    // The liveness threads run indefinitely; in testing, terminate after some time.
+    for(auto &peer : peers)
+        peer->startListener();
+    // Register with seeds and discover neighbors, or dial the neighbors the topology lists.
+    for(size_t i = 0; i < peers.size(); i++) {
+        if(fromTopology)
+            peers[i]->registerWithTopology(plan[i].seeds, plan[i].dials);
+        else
+            peers[i]->registerWithSeeds();
+    }
+    // Schedule gossip generation and liveness checking on each peer's event loop.
+    for(auto &peer : peers) {
+        peer->generateGossip();
+        peer->checkLiveness();
+        peer->startAntiEntropy();
+    }
+    // Liveness checks run indefinitely; in testing, terminate after some time.
 
-    // Optionally join seed server threads (which run indefinitely).
+    // Seed server threads run indefinitely; meanwhile dump peer statistics on SIGUSR1.
+    while(true) {
+        int sig;
+        if(sigwait(&dumpSignals, &sig) != 0)
+            break;
+        for(SeedServer *server : seedServers) {
+            if(seedReplicas > 0)
+                logLine(server->clusterSummary());
+            logLine(server->statsSummary());
+        }
+        for(auto &peer : peers) {
+            for(string dump : {peer->propagationSummary(), peer->forwardSummary(), peer->antiEntropySummary(), peer->livenessSummary(),
+                                peer->queueDelaySummary(), peer->outboundSummary(), peer->transportSummary()}) {
+                if(!dump.empty() && dump.back() == '\n')
+                    dump.pop_back();
+                if(!dump.empty())
+                    logLine(dump);
+            }
+        }
+    }
     for(auto &t : seedThreads) {
         if(t.joinable())
             t.join();
@@ -0,0 +1,288 @@
+// membership.hpp
+/*
+  MembershipTable: versioned set of registered peers ("IP:Port") kept by a SeedServer.
+
+    • Every add of a new peer and every removal bumps the table version and is appended to a
+      bounded change log, so changesSince(N) returns only what changed after version N.
+    • Versions count from 0 again when a seed restarts without its journal (a journaled seed
+      restores both), so each table also has a random epoch. A cursor (epoch, N) from
+      another incarnation, one ahead of the table, or one older than the log gets the full
+      list instead, marked `full`; the requester applies it as a replacement.
+    • snapshot() returns an immutable, shared copy of the comma-delimited list, already split
+      into pages of at most pageBytes. It is rebuilt lazily, at most once per version, when
+      the first reader after a change asks for it. Readers only do an atomic shared_ptr load,
+      so GET_PEERS traffic neither contends on the table lock nor rebuilds the string.
+
+  Thread-safe. The helpers at the end encode and parse table replies as wire.hpp frames.
+*/
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "wire.hpp"
+
+struct MembershipConfig {
+    size_t pageBytes = 64 * 1024;  // max payload of one PEER_LIST / PEER_DELTA frame
+    size_t maxChanges = 65536;     // change-log entries kept for delta requests
+};
+
+struct PeerListSnapshot {
+    uint64_t version = 0;
+    size_t members = 0;
+    std::string list;                               // "IP:Port,IP:Port,..."
+    std::vector<std::pair<size_t, size_t>> pages;   // (offset, length) into list, split at commas
+
+    std::string_view page(size_t i) const { return std::string_view(list).substr(pages[i].first, pages[i].second); }
+};
+
+struct PeerDelta {
+    uint64_t epoch = 0;                // incarnation of the table the versions belong to
+    uint64_t version = 0;
+    bool full = false;                 // added holds the whole table; apply as a replacement
+    std::vector<std::string> added;
+    std::vector<std::string> removed;
+};
+
+// Splits a comma-delimited list into chunks of at most pageBytes (a longer single entry gets
+// its own chunk). Returns (offset, length) pairs; an empty list yields one empty page.
+inline std::vector<std::pair<size_t, size_t>> paginateList(std::string_view list, size_t pageBytes) {
+    std::vector<std::pair<size_t, size_t>> pages;
+    size_t start = 0;
+    while (start < list.size()) {
+        size_t end = list.size();
+        if (end - start > pageBytes) {
+            size_t cut = list.rfind(',', start + pageBytes);
+            if (cut == std::string_view::npos || cut <= start)
+                cut = list.find(',', start);
+            end = cut == std::string_view::npos ? list.size() : cut;
+        }
+        pages.push_back({start, end - start});
+        start = end + 1;
+    }
+    if (pages.empty())
+        pages.push_back({0, 0});
+    return pages;
+}
+
+class MembershipTable {
+public:
+    explicit MembershipTable(const MembershipConfig &cfg = MembershipConfig()) : cfg_(cfg) {
+        epoch_ = randomEpoch();
+        std::atomic_store(&snapshot_, std::shared_ptr<const PeerListSnapshot>(std::make_shared<PeerListSnapshot>()));
+    }
+
+    // Replaces the table with a saved one (SeedJournal recovery), so cursors handed out by the
+    // previous run stay valid. The change log starts empty at that version.
+    void restore(uint64_t epoch, uint64_t version, std::vector<std::string> entries) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        members_.clear();
+        for (auto &e : entries)
+            members_.insert(std::move(e));
+        epoch_ = epoch;
+        changes_.clear();
+        firstLogged_ = version + 1;
+        version_.store(version, std::memory_order_release);
+        rebuildSnapshot();
+    }
+
+    // Starts a new epoch at the current version, for when recovery could not reproduce the
+    // previous run's versions exactly; every cursor then gets a full listing.
+    void renewEpoch() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        epoch_ = randomEpoch();
+        changes_.clear();
+        firstLogged_ = version_.load(std::memory_order_relaxed) + 1;
+    }
+
+    // Returns true if addr was not a member.
+    bool add(const std::string &addr) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!members_.insert(addr).second)
+            return false;
+        record(addr, true);
+        return true;
+    }
+
+    // Returns true if addr was a member.
+    bool remove(const std::string &addr) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (members_.erase(addr) == 0)
+            return false;
+        record(addr, false);
+        return true;
+    }
+
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
+    uint64_t epoch() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return epoch_;
+    }
+
+    std::shared_ptr<const PeerListSnapshot> snapshot() {
+        auto snap = std::atomic_load(&snapshot_);
+        if (snap->version == version())
+            return snap;
+        std::lock_guard<std::mutex> lock(mtx_);
+        snap = std::atomic_load(&snapshot_);
+        if (snap->version == version_.load(std::memory_order_relaxed))
+            return snap; // another reader rebuilt it while we waited
+        return rebuildSnapshot();
+    }
+
+    // Net changes after version `since` of epoch `epoch`; a full listing if the cursor is from
+    // another epoch, ahead of this table, or older than the log.
+    PeerDelta changesSince(uint64_t since, uint64_t epoch) {
+        PeerDelta delta;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            delta.epoch = epoch_;
+            delta.version = version_.load(std::memory_order_relaxed);
+            bool sameTable = epoch == epoch_ && since <= delta.version;
+            if (sameTable && since == delta.version)
+                return delta;
+            if (sameTable && since + 1 >= firstLogged_) {
+                std::unordered_map<std::string, bool> net; // addr -> present at the end
+                size_t skip = since + 1 - firstLogged_;
+                for (size_t i = skip; i < changes_.size(); i++)
+                    net[changes_[i].addr] = changes_[i].added;
+                for (auto &entry : net)
+                    (entry.second ? delta.added : delta.removed).push_back(entry.first);
+                return delta;
+            }
+        }
+        auto snap = snapshot();
+        delta.version = snap->version;
+        delta.full = true;
+        size_t start = 0;
+        const std::string &list = snap->list;
+        while (start < list.size()) {
+            size_t comma = list.find(',', start);
+            size_t end = comma == std::string::npos ? list.size() : comma;
+            delta.added.emplace_back(list, start, end - start);
+            start = end + 1;
+        }
+        return delta;
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return members_.size();
+    }
+
+    uint64_t snapshotBuilds() const { return snapshotBuilds_.load(); }
+    size_t pageBytes() const { return cfg_.pageBytes; }
+
+private:
+    struct Change {
+        std::string addr;
+        bool added;
+    };
+
+    MembershipConfig cfg_;
+    std::mutex mtx_; // guards members_, epoch_, changes_ and firstLogged_; readers of snapshot_ skip it
+    std::unordered_set<std::string> members_;
+    uint64_t epoch_;
+    std::deque<Change> changes_; // changes_[i] produced version firstLogged_ + i
+    uint64_t firstLogged_ = 1;
+    std::atomic<uint64_t> version_{0};
+    std::shared_ptr<const PeerListSnapshot> snapshot_; // accessed with std::atomic_load/store
+    std::atomic<uint64_t> snapshotBuilds_{0};
+
+    static uint64_t randomEpoch() {
+        std::random_device rd;
+        return ((uint64_t)rd() << 32 | rd()) | 1; // never 0, which no requester has seen
+    }
+
+    // Caller holds mtx_.
+    std::shared_ptr<const PeerListSnapshot> rebuildSnapshot() {
+        auto fresh = std::make_shared<PeerListSnapshot>();
+        fresh->version = version_.load(std::memory_order_relaxed);
+        fresh->members = members_.size();
+        for (auto &m : members_) {
+            fresh->list += m;
+            fresh->list += ',';
+        }
+        if (!fresh->list.empty())
+            fresh->list.pop_back();
+        fresh->pages = paginateList(fresh->list, cfg_.pageBytes);
+        snapshotBuilds_++;
+        std::shared_ptr<const PeerListSnapshot> result = fresh;
+        std::atomic_store(&snapshot_, result);
+        return result;
+    }
+
+    void record(const std::string &addr, bool added) {
+        changes_.push_back({addr, added});
+        if (changes_.size() > cfg_.maxChanges) {
+            changes_.pop_front();
+            firstLogged_++;
+        }
+        version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+};
+
+// Appends the snapshot as PEER_LIST frames, one per page, answering GET_PEERS request seq.
+inline void appendPeerListFrames(std::string &out, uint64_t seq, const PeerListSnapshot &snap) {
+    for (size_t i = 0; i < snap.pages.size(); i++)
+        appendFrame(out, MsgType::PeerList, 0, seq, wallClockNs(), snap.page(i),
+                    i + 1 < snap.pages.size() ? FRAME_MORE : 0);
+}
+
+// Appends delta as PEER_DELTA frames of at most pageBytes payload each.
+inline void appendPeerDeltaFrames(std::string &out, uint64_t seq, const PeerDelta &delta, size_t pageBytes) {
+    std::string prefix = std::to_string(delta.epoch) + ";" + std::to_string(delta.version) + (delta.full ? ";1;" : ";0;");
+    std::string added, removed;
+    auto emit = [&](bool more) {
+        appendFrame(out, MsgType::PeerDelta, 0, seq, wallClockNs(), prefix + added + ";" + removed,
+                    more ? FRAME_MORE : 0);
+        added.clear();
+        removed.clear();
+    };
+    auto push = [&](std::string &list, const std::string &addr) {
+        if (prefix.size() + added.size() + removed.size() + addr.size() + 2 > pageBytes &&
+            !(added.empty() && removed.empty()))
+            emit(true);
+        if (!list.empty())
+            list += ',';
+        list += addr;
+    };
+    for (auto &a : delta.added)
+        push(added, a);
+    for (auto &r : delta.removed)
+        push(removed, r);
+    emit(false);
+}
+
+// Merges one PEER_DELTA page into delta. Returns false if the payload is malformed.
+inline bool parsePeerDeltaPage(std::string_view payload, PeerDelta &delta) {
+    size_t e = payload.find(';');
+    size_t a = e == std::string_view::npos ? e : payload.find(';', e + 1);
+    size_t b = a == std::string_view::npos ? a : payload.find(';', a + 1);
+    size_t c = b == std::string_view::npos ? b : payload.find(';', b + 1);
+    if (c == std::string_view::npos)
+        return false;
+    delta.epoch = std::strtoull(std::string(payload.substr(0, e)).c_str(), nullptr, 10);
+    delta.version = std::strtoull(std::string(payload.substr(e + 1, a - e - 1)).c_str(), nullptr, 10);
+    delta.full = payload.substr(a + 1, b - a - 1) == "1";
+    auto split = [](std::string_view list, std::vector<std::string> &out) {
+        while (!list.empty()) {
+            size_t comma = list.find(',');
+            if (comma != 0)
+                out.emplace_back(list.substr(0, comma));
+            list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+        }
+    };
+    split(payload.substr(b + 1, c - b - 1), delta.added);
+    split(payload.substr(c + 1), delta.removed);
+    return true;
+}
@@ -1,8 +1,80 @@
 // main.cpp
+// With no arguments, grows a small overlay and prints its degree distribution after each peer.
+// With --out=FILE, generates a topology file for `main --topology=FILE` and `harness --topology=FILE`:
+//   --out=FILE         where to write it (topology_file.hpp)
+//   --peers=N          peer nodes (default: 1000)
+//   --seeds=N          seed nodes (default: 3)
+//   --base-port=P      nodes are 127.0.0.1:P.. , seeds first (default: 20000)
+//   --seed=S           generator seed; the same seed gives the same file (default: 1)
+//   --threads=N        generator threads, which do not change the result (default: #cores)
 #include "pl.hpp"
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
-int main() {
+// Builds the overlay with add_peers() and writes it; returns the exit status.
+static int writeTopology(const std::string& path, size_t peers, size_t seeds, int basePort, uint64_t seed,
+                         unsigned threads) {
+    NetworkBuilder builder(2.5, 2, 10);
+    builder.seed(seed);
+    builder.set_peer_links_only(true); // seeds do not relay gossip
+    std::vector<std::string> ids;
+    for (size_t i = 0; i < seeds + peers; ++i)
+        ids.push_back("127.0.0.1:" + std::to_string(basePort + i));
+    builder.add_seed_nodes(std::vector<std::string>(ids.begin(), ids.begin() + seeds));
+    builder.add_peers(std::vector<std::string>(ids.begin() + seeds, ids.end()), threads);
+    if (!builder.write_topology(path))
+        return 1;
+    size_t isolated = 0; // peers without a peer neighbor, which no gossip reaches
+    for (uint32_t id = 0; id < builder.node_count(); ++id) {
+        if (builder.type(id) != NodeType::PEER) continue;
+        bool linked = false;
+        for (uint32_t nbr : builder.graph().neighbors(id)) linked = linked || builder.type(nbr) == NodeType::PEER;
+        if (!linked) isolated++;
+    }
+    PowerLawFit fit = builder.power_law_fit();
+    std::cout << path << ": " << builder.node_count() << " nodes, " << builder.edge_count()
+              << " edges, estimated alpha " << fit.alpha << ", KS distance " << builder.goodness_of_fit()
+              << ", " << isolated << " peers without peer neighbors\n";
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        std::string out;
+        size_t peers = 1000, seeds = 3;
+        int basePort = 20000;
+        uint64_t seed = 1;
+        unsigned threads = 0;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto value = [&](const char* prefix) -> const char* {
+                size_t n = strlen(prefix);
+                return arg.compare(0, n, prefix) == 0 ? arg.c_str() + n : nullptr;
+            };
+            const char* v;
+            if ((v = value("--out="))) out = v;
+            else if ((v = value("--peers="))) peers = strtoul(v, nullptr, 10);
+            else if ((v = value("--seeds="))) seeds = strtoul(v, nullptr, 10);
+            else if ((v = value("--base-port="))) basePort = atoi(v);
+            else if ((v = value("--seed="))) seed = strtoull(v, nullptr, 10);
+            else if ((v = value("--threads="))) threads = atoi(v);
+            else {
+                std::cerr << "Unknown option " << arg << "\n";
+                return 1;
+            }
+        }
+        if (out.empty()) {
+            std::cerr << "Usage: " << argv[0] << " --out=FILE [--peers=N] [--seeds=N] [--base-port=P] [--seed=S] [--threads=N]\n";
+            return 1;
+        }
+        if (basePort <= 0 || basePort + seeds + peers > 65536) {
+            std::cerr << "Ports " << basePort << ".." << basePort + seeds + peers - 1 << " are out of range\n";
+            return 1;
+        }
+        return writeTopology(out, peers, seeds, basePort, seed, threads);
+    }
+    
     NetworkBuilder builder(2.5, 2, 10);
     
     // Add seed nodes
@@ -27,7 +99,11 @@ int main() {
         }
         std::cout << "Follows power-law: " 
                   << (builder.follows_power_law_distribution() ? "Yes" : "No") 
-                  << "\n\n";
+                  << "\n";
+        PowerLawFit fit = builder.power_law_fit();
+        std::cout << "Estimated alpha: " << fit.alpha << " +/- " << fit.std_error
+                  << " over " << fit.tail_nodes << " nodes, KS distance: "
+                  << builder.goodness_of_fit() << "\n\n";
     }
     
     return 0;
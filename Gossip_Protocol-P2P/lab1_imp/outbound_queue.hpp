@@ -0,0 +1,215 @@
+// outbound_queue.hpp
+/*
+  OutboundQueue: bounded per-connection send queue flushed with scatter-gather writes.
+
+    • Frames are queued as shared, immutable buffers, so one gossip frame forwarded to many
+      neighbors is encoded and stored once.
+    • Each TrafficClass (wire.hpp) has its own lane with strict priority: every flush writes
+      the queued control frames (PING/PONG) before any data frame. A partially written frame
+      is always finished first, since frames cannot interleave on a stream.
+    • flush() writes up to IOV_BATCH frames per sendmsg() call (writev() plus MSG_NOSIGNAL)
+      and keeps the offset into a partially written frame.
+    • When the queued bytes exceed highWatermark the SlowPolicy applies:
+        DropOldest  drop the oldest data frames until the queue is back at lowWatermark;
+                    control frames and a partially written frame are never dropped.
+        Disconnect  push() returns false and the owner closes the connection.
+    • Counters (current/peak depth, frames dropped, write calls) feed summary(). With a
+      QueueDelays sink attached, the time from push() until the socket took the whole frame
+      is recorded per class.
+    • The deque's chunks come from the SlabPool (frame_pool.hpp), so a queue that keeps
+      filling and draining does not allocate.
+
+  Not thread-safe; a queue belongs to the loop that owns its connection.
+*/
+#pragma once
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <sstream>
+#include <string>
+#include "frame_pool.hpp"
+#include "histogram.hpp"
+#include "wire.hpp"
+
+enum class SlowPolicy { DropOldest, Disconnect };
+
+struct OutboundConfig {
+    size_t highWatermark = 1 << 20;   // bytes queued before the policy kicks in
+    size_t lowWatermark = 256 << 10;  // DropOldest trims the queue down to this
+    SlowPolicy policy = SlowPolicy::DropOldest;
+};
+
+// Queueing delay per traffic class, in nanoseconds; shared by the queues of one event loop.
+struct QueueDelays {
+    LatencyHistogram byClass[TRAFFIC_CLASSES];
+
+    void record(TrafficClass cls, uint64_t ns) { byClass[(int)cls].record(ns); }
+
+    void merge(const QueueDelays &o) {
+        for (int i = 0; i < TRAFFIC_CLASSES; i++)
+            byClass[i].merge(o.byClass[i]);
+    }
+
+    // "control <histogram in us>; data <histogram in us>"
+    std::string summary() const {
+        return "control " + byClass[(int)TrafficClass::Control].summary(1e3, "us") + "; data " +
+               byClass[(int)TrafficClass::Data].summary(1e3, "us");
+    }
+};
+
+class OutboundQueue {
+public:
+    using Frame = std::shared_ptr<const std::string>;
+    enum class FlushResult { Drained, Blocked, Error };
+    static const int IOV_BATCH = 64;
+
+    explicit OutboundQueue(const OutboundConfig &cfg = OutboundConfig()) : cfg_(cfg) {}
+
+    // Records the queueing delay of every frame sent from now on into delays (may be null).
+    void trackDelays(QueueDelays *delays) { delays_ = delays; }
+
+    // Queues a frame in its class's lane. Returns false if the queue is over its high
+    // watermark under the Disconnect policy.
+    bool push(Frame frame, TrafficClass cls = TrafficClass::Data) {
+        bytes_ += frame->size();
+        lanes_[(int)cls].push_back({std::move(frame), delays_ ? monotonicNs() : 0});
+        if (bytes_ > peakBytes_)
+            peakBytes_ = bytes_;
+        if (frames() > peakFrames_)
+            peakFrames_ = frames();
+        if (bytes_ <= cfg_.highWatermark)
+            return true;
+        if (cfg_.policy == SlowPolicy::Disconnect) {
+            overflows_++;
+            return false;
+        }
+        trim();
+        return true;
+    }
+
+    // Writes as much as the socket accepts: the partially written frame, then control frames,
+    // then data frames.
+    FlushResult flush(int fd) {
+        while (!empty()) {
+            struct iovec iov[IOV_BATCH];
+            int n = 0;
+            if (offset_ > 0) {
+                const Frame &f = lanes_[partial_].front().data;
+                iov[0].iov_base = const_cast<char *>(f->data()) + offset_;
+                iov[0].iov_len = f->size() - offset_;
+                batchLanes_[n++] = partial_;
+            }
+            for (int lane = 0; lane < TRAFFIC_CLASSES; lane++) {
+                auto it = lanes_[lane].begin();
+                if (offset_ > 0 && lane == partial_)
+                    ++it;
+                for (; it != lanes_[lane].end() && n < IOV_BATCH; ++it, ++n) {
+                    iov[n].iov_base = const_cast<char *>(it->data->data());
+                    iov[n].iov_len = it->data->size();
+                    batchLanes_[n] = lane;
+                }
+            }
+            struct msghdr msg = {};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = n;
+            ssize_t written = sendmsg(fd, &msg, MSG_NOSIGNAL);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    return FlushResult::Blocked;
+                return FlushResult::Error;
+            }
+            writeCalls_++;
+            bytesSent_ += written;
+            consume((size_t)written);
+        }
+        return FlushResult::Drained;
+    }
+
+    bool empty() const { return lanes_[0].empty() && lanes_[1].empty(); }
+    size_t bytes() const { return bytes_; }
+    size_t frames() const { return lanes_[0].size() + lanes_[1].size(); }
+    uint64_t framesDropped() const { return framesDropped_; }
+
+    std::string summary() const {
+        std::string out;
+        appendSummary(out);
+        return out;
+    }
+
+    // Appends summary() to out without a temporary stream, for the disconnect path.
+    void appendSummary(std::string &out) const {
+        char buf[320];
+        int n = snprintf(buf, sizeof(buf),
+                         "queue_bytes=%zu queue_frames=%zu queue_control_frames=%zu peak_bytes=%zu peak_frames=%zu "
+                         "sent_frames=%llu sent_bytes=%llu writes=%llu dropped=%llu overflows=%llu",
+                         bytes_, frames(), lanes_[(int)TrafficClass::Control].size(), peakBytes_, peakFrames_,
+                         (unsigned long long)framesSent_, (unsigned long long)bytesSent_,
+                         (unsigned long long)writeCalls_, (unsigned long long)framesDropped_,
+                         (unsigned long long)overflows_);
+        out.append(buf, std::min<size_t>(n, sizeof(buf) - 1));
+    }
+
+private:
+    struct Entry {
+        Frame data;
+        uint64_t queuedNs; // monotonicNs() at push(), when delays are tracked
+    };
+    using Lane = std::deque<Entry, SlabAllocator<Entry>>; // chunks recycled through the SlabPool
+
+    OutboundConfig cfg_;
+    Lane lanes_[TRAFFIC_CLASSES];  // indexed by TrafficClass
+    int batchLanes_[IOV_BATCH];    // lane of each iovec in the current write
+    int partial_ = 0;              // lane whose front is partially written, if offset_ > 0
+    QueueDelays *delays_ = nullptr;
+    size_t offset_ = 0;  // bytes of the partial frame already written
+    size_t bytes_ = 0;   // unsent bytes in the queue
+    size_t peakBytes_ = 0;
+    size_t peakFrames_ = 0;
+    uint64_t framesSent_ = 0;
+    uint64_t bytesSent_ = 0;
+    uint64_t writeCalls_ = 0;
+    uint64_t framesDropped_ = 0;
+    uint64_t overflows_ = 0;
+
+    // Retires the first n written bytes, walking the frames in the order flush() wrote them.
+    void consume(size_t n) {
+        bytes_ -= n;
+        uint64_t now = delays_ ? monotonicNs() : 0;
+        for (int i = 0; n > 0; i++) {
+            Lane &lane = lanes_[batchLanes_[i]];
+            size_t left = lane.front().data->size() - offset_;
+            if (n < left) {
+                offset_ += n;
+                partial_ = batchLanes_[i];
+                return;
+            }
+            n -= left;
+            offset_ = 0;
+            if (delays_)
+                delays_->record((TrafficClass)batchLanes_[i], now - lane.front().queuedNs);
+            lane.pop_front();
+            framesSent_++;
+        }
+    }
+
+    // Drops the oldest data frames (never a partially written one) down to lowWatermark.
+    void trim() {
+        overflows_++;
+        Lane &data = lanes_[(int)TrafficClass::Data];
+        auto it = data.begin();
+        if (offset_ > 0 && partial_ == (int)TrafficClass::Data)
+            ++it;
+        while (it != data.end() && bytes_ > cfg_.lowWatermark) {
+            bytes_ -= it->data->size();
+            it = data.erase(it);
+            framesDropped_++;
+        }
+    }
+};
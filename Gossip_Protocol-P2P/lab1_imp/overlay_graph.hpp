@@ -0,0 +1,222 @@
+// overlay_graph.hpp
+/*
+  Compact storage for generated overlay topologies (pl.hpp).
+
+    • NameTable interns node names. Each name is stored once in one shared character buffer
+      and gets a dense id (0, 1, 2, ... in insertion order); lookups go through an
+      open-addressing table of ids, so a name costs its bytes plus 16 to 24 bytes.
+    • AdjacencyStore keeps each node's neighbor ids in a block of one shared id array. A full
+      block grows in place when it is the last one, or moves with twice the room, so adding
+      an edge is amortized O(1) with 16 bytes of bookkeeping per node. A moved block's space
+      goes on a free list for its size and is reused by the next block of that size (new
+      nodes take blocks of their expected degree), so the array stays close to the edge count.
+    • freeze() compacts the store into a CsrGraph: an offsets array of n + 1 entries and one
+      targets array with each node's neighbors sorted, the layout that traversals and
+      serialization want.
+
+  An edge is two 4-byte ids, one in each endpoint's block, instead of two hash-set nodes
+  holding shared_ptrs. Ids are 32-bit, so a graph holds fewer than 2^32 nodes. Not thread-safe.
+*/
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+const uint32_t NO_NODE = UINT32_MAX;
+
+enum class NodeType : uint8_t { SEED, PEER };
+
+// A node's neighbor ids, valid until the graph changes.
+struct NeighborRange {
+    const uint32_t *first;
+    const uint32_t *last;
+
+    const uint32_t *begin() const { return first; }
+    const uint32_t *end() const { return last; }
+    size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+    uint32_t operator[](size_t i) const { return first[i]; }
+};
+
+class NameTable {
+public:
+    // Returns the id of name, adding it if it is new.
+    uint32_t intern(std::string_view name) {
+        if ((size() + 1) * 2 > slots_.size())
+            rehash(std::max<size_t>(16, slots_.size() * 2));
+        size_t slot = probe(name);
+        if (slots_[slot] == NO_NODE) {
+            slots_[slot] = (uint32_t)size();
+            chars_.append(name);
+            offsets_.push_back(chars_.size());
+        }
+        return slots_[slot];
+    }
+
+    // NO_NODE if name was never interned.
+    uint32_t find(std::string_view name) const { return slots_.empty() ? NO_NODE : slots_[probe(name)]; }
+
+    std::string_view name(uint32_t id) const {
+        return std::string_view(chars_.data() + offsets_[id], offsets_[id + 1] - offsets_[id]);
+    }
+
+    size_t size() const { return offsets_.size() - 1; }
+
+    size_t memory_bytes() const {
+        return chars_.capacity() + offsets_.capacity() * sizeof(uint64_t) + slots_.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    std::string chars_;                  // all names back to back
+    std::vector<uint64_t> offsets_{0};   // name i is chars_[offsets_[i], offsets_[i + 1])
+    std::vector<uint32_t> slots_;        // ids by name hash, linear probing; NO_NODE is empty
+
+    // The slot holding name, or the empty slot where it belongs.
+    size_t probe(std::string_view name) const {
+        size_t mask = slots_.size() - 1;
+        size_t slot = std::hash<std::string_view>()(name) & mask;
+        while (slots_[slot] != NO_NODE && this->name(slots_[slot]) != name)
+            slot = (slot + 1) & mask;
+        return slot;
+    }
+
+    void rehash(size_t capacity) {
+        slots_.assign(capacity, NO_NODE);
+        for (uint32_t id = 0; id < size(); id++)
+            slots_[probe(name(id))] = id;
+    }
+};
+
+// Read-only adjacency in compressed sparse row form.
+struct CsrGraph {
+    std::vector<uint64_t> offsets{0}; // node i's neighbors are targets[offsets[i], offsets[i + 1])
+    std::vector<uint32_t> targets;    // sorted within each node
+
+    size_t node_count() const { return offsets.size() - 1; }
+    size_t edge_count() const { return targets.size() / 2; }
+    uint32_t degree(uint32_t id) const { return (uint32_t)(offsets[id + 1] - offsets[id]); }
+
+    NeighborRange neighbors(uint32_t id) const {
+        return {targets.data() + offsets[id], targets.data() + offsets[id + 1]};
+    }
+
+    bool has_edge(uint32_t a, uint32_t b) const {
+        NeighborRange r = neighbors(a);
+        return std::binary_search(r.begin(), r.end(), b);
+    }
+
+    size_t memory_bytes() const {
+        return offsets.capacity() * sizeof(uint64_t) + targets.capacity() * sizeof(uint32_t);
+    }
+};
+
+// Undirected graph that grows one node or edge at a time.
+class AdjacencyStore {
+public:
+    // expected_degree sizes the node's first block, saving moves when it is known.
+    uint32_t add_node(uint32_t expected_degree = 0) {
+        blocks_.push_back({expected_degree ? allocate(expected_degree) : 0, 0, expected_degree});
+        return (uint32_t)(blocks_.size() - 1);
+    }
+
+    // Adds the edge a-b; false if a == b or the edge exists.
+    bool add_edge(uint32_t a, uint32_t b) {
+        if (a == b || has_edge(a, b))
+            return false;
+        append(a, b);
+        append(b, a);
+        edges_++;
+        return true;
+    }
+
+    // Scans the smaller of the two neighbor lists.
+    bool has_edge(uint32_t a, uint32_t b) const {
+        if (blocks_[a].size > blocks_[b].size)
+            std::swap(a, b);
+        NeighborRange r = neighbors(a);
+        return std::find(r.begin(), r.end(), b) != r.end();
+    }
+
+    uint32_t degree(uint32_t id) const { return blocks_[id].size; }
+    size_t node_count() const { return blocks_.size(); }
+    size_t edge_count() const { return edges_; }
+
+    NeighborRange neighbors(uint32_t id) const {
+        const uint32_t *first = ids_.data() + blocks_[id].offset;
+        return {first, first + blocks_[id].size};
+    }
+
+    CsrGraph freeze() const {
+        CsrGraph csr;
+        csr.offsets.resize(blocks_.size() + 1);
+        csr.targets.reserve(edges_ * 2);
+        for (size_t id = 0; id < blocks_.size(); id++) {
+            NeighborRange r = neighbors((uint32_t)id);
+            csr.targets.insert(csr.targets.end(), r.begin(), r.end());
+            std::sort(csr.targets.end() - r.size(), csr.targets.end());
+            csr.offsets[id + 1] = csr.targets.size();
+        }
+        return csr;
+    }
+
+    size_t memory_bytes() const {
+        size_t bytes = blocks_.capacity() * sizeof(Block) + ids_.capacity() * sizeof(uint32_t);
+        for (auto &entry : free_blocks_)
+            bytes += entry.second.capacity() * sizeof(uint64_t);
+        return bytes;
+    }
+
+private:
+    struct Block {
+        uint64_t offset;   // first slot in ids_
+        uint32_t size;
+        uint32_t capacity;
+    };
+
+    std::vector<Block> blocks_;  // indexed by node id
+    std::vector<uint32_t> ids_;  // every block, plus free ones
+    std::unordered_map<uint32_t, std::vector<uint64_t>> free_blocks_; // capacity -> offsets
+    size_t edges_ = 0;
+
+    void append(uint32_t id, uint32_t neighbor) {
+        Block &b = blocks_[id];
+        if (b.size == b.capacity) {
+            uint32_t capacity = b.capacity ? b.capacity * 2 : 4;
+            if (b.capacity > 0 && b.offset + b.capacity == ids_.size()) {
+                grow_ids(b.offset + capacity); // last block: grow in place
+            } else {
+                uint64_t offset = allocate(capacity);
+                std::copy(ids_.begin() + b.offset, ids_.begin() + b.offset + b.size, ids_.begin() + offset);
+                if (b.capacity > 0)
+                    free_blocks_[b.capacity].push_back(b.offset);
+                b.offset = offset;
+            }
+            b.capacity = capacity;
+        }
+        ids_[b.offset + b.size++] = neighbor;
+    }
+
+    // Offset of a block of capacity slots: a free one of that size, or new space at the end.
+    uint64_t allocate(uint32_t capacity) {
+        auto it = free_blocks_.find(capacity);
+        if (it != free_blocks_.end() && !it->second.empty()) {
+            uint64_t offset = it->second.back();
+            it->second.pop_back();
+            return offset;
+        }
+        uint64_t offset = ids_.size();
+        grow_ids(offset + capacity);
+        return offset;
+    }
+
+    // Resizes ids_, growing its capacity by half rather than doubling it.
+    void grow_ids(size_t size) {
+        if (size > ids_.capacity())
+            ids_.reserve(std::max(size, ids_.capacity() + ids_.capacity() / 2));
+        ids_.resize(size);
+    }
+};
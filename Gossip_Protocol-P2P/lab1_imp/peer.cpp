@@ -2,16 +2,61 @@
 /*
   PeerNode implements a TCP-socket–based peer node that supports:
     • Listening for connections (to receive gossip messages and pings).
-    • Registering with a randomly selected subset of seeds (floor(n/2)+1) from config.
+    • Registering with a randomly selected subset of seeds (floor(n/2)+1) from config, over one
+      persistent session per seed that also carries GET_PEERS and batched DEAD reports
+      (seed_session.hpp).
     • Retrieving a weighted (preferential) union of peer lists from seeds.
     • Selecting up to 3 neighbors (using duplicates to bias high-degree peers).
-    • Establishing outgoing connections to neighbors.
+    • Establishing outgoing connections to neighbors: seeds are queried and candidates dialed
+      concurrently under one deadline, replacing candidates that fail (BootstrapConfig).
     • Generating gossip messages every 5 seconds in the format:
           <timestamp>:<self.IP>:<self.Msg#>
-    • Forwarding new gossip messages to neighbors, avoiding duplicates.
-    • Pinging neighbors every 13 seconds with nonblocking I/O; if 3 consecutive pings fail, sending a
-      DEAD message (format: Dead Node:<DeadNode.IP>:<DeadNode.Port>:<self.timestamp>:<self.IP>) to all seeds.
-      
+    • Forwarding new gossip messages to neighbors, avoiding duplicates with a bounded-memory,
+      sharded filter keyed on (origin id, sequence number) (dedup.hpp). Messages are flooded
+      to every neighbor, or in rumor mode pushed to an adaptive random fanout with a TTL and
+      a stop-after-k-duplicates rule (rumor.hpp, RumorConfig).
+    • Pinging neighbors every 13 seconds with nonblocking I/O, measuring RTT and timing out each ping
+      after an adaptive RTO (liveness.hpp); an unanswered ping is retried at once with the RTO
+      doubled, and if 3 in a row fail while nothing else arrives from the neighbor either,
+      sending a DEAD message
+      (format: Dead Node:<DeadNode.IP>:<DeadNode.Port>:<self.timestamp>:<self.IP>) to all seeds.
+    • Speaking the length-prefixed binary frame protocol from wire.hpp to peers and seeds.
+    • Reconciling recent gossip with each outbound neighbor every few seconds using IBLT
+      digests (anti_entropy.hpp), so a peer that missed messages, e.g. after being declared
+      dead and rejoining, fetches just those.
+    • Recording, for every new gossip message, its latency from the origin's monotonic
+      timestamp and the hops it took (propagation.hpp); propagationSummary() dumps them.
+
+  A peer's sockets run on nonblocking EventLoops. The control loop (`loop`) owns the listener,
+  timers (gossip generation, pings), bootstrap and seed sessions; with ioThreads > 1, neighbor
+  connections are spread round-robin over that many loops so receiving and forwarding proceed
+  in parallel. Shared state is split so no path takes a global lock:
+    • connections belong to one loop and are only touched on that loop's thread;
+    • the neighbor table is a copy-on-write snapshot (cow.hpp) read lock-free by every loop;
+    • duplicate suppression is a ShardedDedup with one lock per shard;
+    • liveness state lives on the control loop (PONGs are handed to it with postUrgent()).
+  Each connection sends from a bounded OutboundQueue (outbound_queue.hpp): frames queued while a
+  loop handles one batch of events are flushed together with one scatter-gather write, and a
+  neighbor that stops reading loses its oldest gossip or is disconnected (OutboundConfig).
+  PING/PONG have strict priority over gossip and anti-entropy (TrafficClass, wire.hpp): they
+  take the queue's control lane and are written at once, are handled before the data frames
+  read with them, and cross loops through postUrgent(). queueDelaySummary() reports how long
+  frames of each class wait in the send queues.
+
+  The receive-to-forward path does not allocate in steady state: frames are parsed as views
+  into each connection's FrameReader buffer, a new message is re-encoded once into a recycled
+  FramePool buffer shared by every neighbor's queue and the recent-message store (frame_pool.hpp),
+  queues and stores take their nodes from the SlabPool, per-message scratch vectors live in the
+  IoLoop, and the log line is built in a reused thread-local buffer with a cached timestamp.
+
+  With transport = Transport::Udp, neighbor traffic uses one UDP socket per peer instead
+  (datagram.hpp), served by the control loop. Every remote "IP:Port" heard from or dialed is a
+  PeerConn with a negative handle in place of an fd, so the frame handling above is shared;
+  queueSend() hands its frames to the DatagramSocket, which batches them with sendmmsg()/
+  recvmmsg(). Dialing needs no handshake: a dialed neighbor is usable at once and liveness
+  pings find out whether it answers. With UdpConfig::retransmit, received gossip is
+  acknowledged (ACK frames, batched per pass) and unacknowledged gossip is resent.
+
   Advanced error checking, nonblocking I/O, and additional security (e.g., TLS and message signing) are noted
   but only basic support is implemented.
 */
@@ -28,15 +73,40 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <mutex>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
 #include <chrono>
 #include <random>
 #include <ctime>
 #include <cstring>
 #include <cstdlib>
 #include <algorithm>
-#include <random>  
+#include <random>
+#include "event_loop.hpp"
+#include "cow.hpp"
+#include "wire.hpp"
+#include "dedup.hpp"
+#include "logger.hpp"
+#include "liveness.hpp"
+#include "seed_session.hpp"
+#include "outbound_queue.hpp"
+#include "propagation.hpp"
+#include "anti_entropy.hpp"
+#include "rumor.hpp"
+#include "datagram.hpp"
+#include "frame_pool.hpp"
+#include "topology_file.hpp"
 using namespace std;
 
+// Limits for PeerNode::registerWithSeeds().
+struct BootstrapConfig {
+    chrono::milliseconds deadline{5000}; // whole bootstrap: seed replies and neighbor connects
+    chrono::milliseconds seedWait{2000}; // start dialing even if some seeds have not answered
+    int targetNeighbors = 3;
+};
+
 class PeerNode {
 public:
     string myIP;  // e.g., "127.0.0.1"
@@ -45,47 +115,235 @@ public:
     vector<pair<string,int>> allSeeds;
     // Seeds selected for registration (floor(n/2)+1).
     vector<pair<string,int>> chosenSeeds;
-    // Connected neighbors in "IP:Port" format.
+    // Connected neighbors in "IP:Port" format (control loop only).
     unordered_set<string> connectedNeighbors;
-    // Map from neighbor to its socket FD.
-    unordered_map<string, int> neighborSock;
-    // Tracking ping failures.
-    unordered_map<string, int> pingFailures;
-    // Processed gossip messages.
-    unordered_set<string> messageHistory;
-    mutex mtx;
-    ofstream outputFile;
-
-    PeerNode(const string &ip, const string &port, const vector<pair<string,int>> &seeds)
-      : myIP(ip), myPort(port), allSeeds(seeds) {
-        outputFile.open("outputfile.txt", ios::app);
-        if(!outputFile.is_open())
-            cerr << "Error opening outputfile.txt" << endl;
+    // Ids of processed gossip messages, checked from every I/O loop.
+    ShardedDedup messageHistory;
+
+    struct PeerConn;
+    struct ConnRef;
+    using NeighborTable = CopyOnWrite<unordered_map<string, ConnRef>>;
+    // An event loop serving connections, and the connections it owns (touched only on its thread).
+    struct IoLoop {
+        EventLoop *loop;
+        unordered_map<int, PeerConn*> conns;
+        NeighborTable::Cache neighbors; // this loop's snapshot of neighborSock
+        PropagationStats propagation;   // gossip received on this loop's connections
+        QueueDelays queueDelays;         // send-queue delay per traffic class on this loop
+        vector<uint64_t> hotRumors;      // rumors this loop keeps pushing (rumor mode)
+        mt19937 rng{random_device{}()};
+        // Reused per message, so forwarding does not allocate.
+        vector<ConnRef> forwardTargets;
+        vector<PeerConn*> localTargets;
+        vector<uint64_t> hotScratch;     // rumorRound()'s next hotRumors
+        // Reused by every anti-entropy round and ACK on this loop (tables, decoded ids, payloads).
+        Iblt digestMine, digestTheirs;
+        vector<uint64_t> onlyMine, onlyTheirs;
+        string payloadScratch;
+        // Frames other loops queue for this loop's connections (sendGossip), drained by one
+        // posted task; inboxBatch keeps the drained buffer's capacity.
+        mutex inboxMtx;
+        vector<pair<ConnRef, OutboundQueue::Frame>> inbox;
+        vector<pair<ConnRef, OutboundQueue::Frame>> inboxBatch;
+        // Connections with frames queued in this loop pass, flushed together at its end.
+        vector<ConnRef> pendingFlush;
+        vector<ConnRef> flushBatch;
+    };
+    // One nonblocking socket served by one IoLoop.
+    struct PeerConn {
+        int fd;
+        uint64_t id;        // unique per PeerNode, guards against fd reuse in cross-loop references
+        IoLoop *io;
+        string addr;        // "IP:Port" for outbound neighbors, sender IP for inbound connections
+        bool outbound;
+        OutboundQueue out;  // frames not yet accepted by the socket
+        bool wantWrite;     // EPOLLOUT currently armed
+        bool flushScheduled; // a deferred flush is pending on the loop
+        FrameReader reader;
+        size_t digestCells;  // IBLT size of this connection's current anti-entropy round
+        uint64_t digestRound;
+        int digestRetries;
+        // Transport::Udp only: the remote endpoint, gossip ids to acknowledge in this pass, and
+        // gossip sent but not yet acknowledged (retransmission on).
+        sockaddr_in udpAddr;
+        vector<uint64_t> acks;
+        struct Unacked {
+            OutboundQueue::Frame frame;
+            int attempts;
+            chrono::steady_clock::time_point deadline;
+        };
+        unordered_map<uint64_t, Unacked> unacked;
+        // Outbound neighbors: when a frame last arrived (steady-clock ns), read by liveness.
+        // Inbound UDP endpoints get a stamp of their own, for expireUdpConns().
+        shared_ptr<atomic<int64_t>> heard;
+    };
+    // Reference to a connection that is safe to hold on any thread; resolve it with findConn()
+    // on the owning loop. fd is -1 once the connection has been closed.
+    struct ConnRef {
+        int fd;
+        IoLoop *io;
+        uint64_t connId;
+    };
+    // Outbound neighbor "IP:Port" -> connection. Read on every forward, written on connect,
+    // disconnect and DEAD.
+    NeighborTable neighborSock;
+    // Outbound neighbor "IP:Port" -> its connection's `heard` stamp (control loop only).
+    unordered_map<string, shared_ptr<atomic<int64_t>>> heardFrom;
+
+    EventLoop loop;
+    thread loopThread;
+    // Number of I/O loops (including `loop`); set before startListener().
+    int ioThreads = 1;
+    vector<unique_ptr<IoLoop>> ioLoops;
+    vector<unique_ptr<EventLoop>> extraLoops;
+    vector<thread> extraThreads;
+    atomic<uint64_t> nextConnId{0};
+    size_t nextIo = 0; // round-robin cursor, control loop only
+    int listenFd = -1;
+    uint64_t myOriginId;
+    int gossipCount = 0;
+    // High 32 bits of this run's gossip seqs. gossipCount restarts at 1 with the process, so
+    // without it a restarted peer's messages would reuse ids its neighbors still remember and
+    // be dropped as duplicates.
+    uint64_t incarnation = (uint64_t)random_device{}() << 32;
+    EventLoop::TimerId gossipTimer = 0;
+    // Optional; called on the receiving I/O loop for every new (non-duplicate) gossip frame.
+    function<void(const FrameHeader &)> onGossipDelivered;
+    // Per-neighbor ping timers, RTT estimates and failure counts.
+    LivenessEngine liveness;
+    // One long-lived session per chosen seed.
+    vector<unique_ptr<SeedSession>> seedSessions;
+    BootstrapConfig bootstrapConfig;
+    // Per-connection send queue limits; set before startListener().
+    OutboundConfig outboundConfig;
+    // Anti-entropy: frames of recently seen gossip, served to neighbors that lack them.
+    AntiEntropyConfig antiEntropyConfig;
+    RecentMessages recentMessages;
+    EventLoop::TimerId antiEntropyTimer = 0;
+    bool antiEntropyStarted = false; // control loop only
+    struct AntiEntropyCounters {
+        atomic<uint64_t> digestsSent{0};
+        atomic<uint64_t> digestsAnswered{0};
+        atomic<uint64_t> retries{0};        // digests too small to decode, answered with FRAME_RETRY
+        atomic<uint64_t> decodeFailures{0}; // undecodable even at maxCells
+        atomic<uint64_t> pushed{0};         // frames sent because the digest sender lacked them
+        atomic<uint64_t> wanted{0};         // ids requested from digest senders
+        atomic<uint64_t> served{0};         // frames sent in answer to WANT
+    } antiEntropyCounters;
+    // Forwarding mode; set before startListener().
+    RumorConfig rumorConfig;
+    RumorTable<ConnRef> rumors;
+    atomic<int> fanout{2}; // current rumor fanout, adapted on the control loop
+    uint64_t lastAdaptReceived = 0, lastAdaptDuplicates = 0; // control loop only
+    struct ForwardCounters {
+        atomic<uint64_t> received{0};      // gossip frames received
+        atomic<uint64_t> duplicates{0};    // ... of which already seen
+        atomic<uint64_t> forwards{0};      // new messages this peer forwarded (or originated)
+        atomic<uint64_t> framesSent{0};    // gossip frames queued to neighbors
+        atomic<uint64_t> bytesSent{0};
+        atomic<uint64_t> floodFrames{0};   // frames flooding the same messages would have sent
+        atomic<uint64_t> floodBytes{0};
+        atomic<uint64_t> ttlExpired{0};    // delivered but not forwarded: hop limit reached
+        atomic<uint64_t> killedByDuplicates{0};
+    } forwardCounters;
+    // Neighbor transport; set before startListener().
+    Transport transport = Transport::Tcp;
+    UdpConfig udpConfig;
+    DatagramSocket udp;                          // Transport::Udp, control loop only
+    unordered_map<uint64_t, PeerConn*> udpConns; // endpointKey -> conn
+    int nextUdpHandle = -2;                      // stands in for an fd; -1 means closed
+    vector<PeerConn*> udpAckDue;                 // conns with acks to send in this pass
+    bool udpFlushScheduled = false;
+    bool udpWantWrite = false;
+    EventLoop::TimerId retransmitTimer = 0;
+    EventLoop::TimerId udpIdleTimer = 0;
+    struct UdpCounters {
+        atomic<uint64_t> retransmits{0};
+        atomic<uint64_t> gaveUp{0};     // gossip frames never acknowledged after maxRetries
+        atomic<uint64_t> acksSent{0};
+        atomic<uint64_t> expired{0};    // idle inbound endpoints forgotten
+    } udpCounters;
+
+    PeerNode(const string &ip, const string &port, const vector<pair<string,int>> &seeds,
+             const DedupConfig &dedupConfig = DedupConfig(),
+             const LivenessConfig &livenessConfig = LivenessConfig(),
+             const AntiEntropyConfig &aeConfig = AntiEntropyConfig())
+      : myIP(ip), myPort(port), allSeeds(seeds), messageHistory(dedupConfig),
+        myOriginId(makeOriginId(ip, atoi(port.c_str()))),
+        liveness(loop,
+                 [this](const string &nbr, uint64_t nonce) { return sendPing(nbr, nonce); },
+                 [this](const string &nbr) { reportDeadNeighbor(nbr); },
+                 [this](const string &nbr) { return lastHeardFrom(nbr); },
+                 livenessConfig),
+        antiEntropyConfig(aeConfig), recentMessages(aeConfig) {
+        ioLoops.push_back(make_unique<IoLoop>());
+        ioLoops[0]->loop = &loop;
+    }
+
+    ~PeerNode() {
+        for(auto &l : extraLoops)
+            l->stop();
+        for(auto &t : extraThreads)
+            t.join();
+        if(loopThread.joinable()) {
+            loop.stop();
+            loopThread.join();
+        }
+        for(auto &io : ioLoops) {
+            for(auto &entry : io->conns) {
+                if(entry.first >= 0)
+                    close(entry.first);
+                delete entry.second;
+            }
+        }
+        if(listenFd >= 0)
+            close(listenFd);
     }
 
     // Utility function: get current timestamp.
     string getCurrentTimestamp() {
+        string timestamp;
+        appendTimestamp(timestamp);
+        return timestamp;
+    }
+
+    // Appends "YYYY-mm-dd HH:MM:SS". Each thread formats the time once per second and copies
+    // the cached text otherwise.
+    static void appendTimestamp(string &out) {
+        thread_local time_t cachedSecond = -1;
+        thread_local char cached[64];
+        thread_local size_t cachedLen = 0;
         time_t now = time(nullptr);
-        char timebuf[64];
-        struct tm *timeinfo = localtime(&now);
-        if (strftime(timebuf, sizeof(timebuf), "%Y-%m-%d %H:%M:%S", timeinfo) == 0)
-            return "00-00-00 00:00:00";
-        return string(timebuf);
+        if(now != cachedSecond) {
+            struct tm timeinfo;
+            localtime_r(&now, &timeinfo);
+            cachedLen = strftime(cached, sizeof(cached), "%Y-%m-%d %H:%M:%S", &timeinfo);
+            if(cachedLen == 0)
+                cachedLen = snprintf(cached, sizeof(cached), "00-00-00 00:00:00");
+            cachedSecond = now;
+        }
+        out.append(cached, cachedLen);
     }
 
     // ------------------------------
     // Peer Listener: Accept incoming connections.
     // ------------------------------
+    // Creates the nonblocking listening socket and registers it with the loop (or, over UDP, the
+    // peer's one datagram socket).
     void listenForPeerConnections() {
-        int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
-        if(listen_fd < 0) {
+        if(transport == Transport::Udp) {
+            openDatagramSocket();
+            return;
+        }
+        listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if(listenFd < 0) {
             perror("Peer listener socket creation failed");
             exit(EXIT_FAILURE);
         }
         int opt = 1;
-        if(setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        if(setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
             perror("setsockopt failed");
-            close(listen_fd);
+            close(listenFd);
             exit(EXIT_FAILURE);
         }
         struct sockaddr_in address;
@@ -93,313 +351,1161 @@ public:
         address.sin_family = AF_INET;
         address.sin_addr.s_addr = inet_addr(myIP.c_str());
         address.sin_port = htons(atoi(myPort.c_str()));
-        if(bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        if(bind(listenFd, (struct sockaddr *)&address, sizeof(address)) < 0) {
             perror("Peer bind failed");
-            close(listen_fd);
+            close(listenFd);
             exit(EXIT_FAILURE);
         }
-        if(listen(listen_fd, 10) < 0) {
+        if(listen(listenFd, SOMAXCONN) < 0) {
             perror("Peer listen failed");
-            close(listen_fd);
+            close(listenFd);
             exit(EXIT_FAILURE);
         }
         cout << "Peer listening on " << myIP << ":" << myPort << endl;
+        loop.add(listenFd, EPOLLIN, [this](uint32_t) { acceptReady(); });
+    }
+
+    void acceptReady() {
         while(true) {
             struct sockaddr_in clientAddr;
             socklen_t addrLen = sizeof(clientAddr);
-            int clientSock = accept(listen_fd, (struct sockaddr *)&clientAddr, &addrLen);
+            int clientSock = accept4(listenFd, (struct sockaddr *)&clientAddr, &addrLen, SOCK_NONBLOCK | SOCK_CLOEXEC);
             if(clientSock < 0) {
-                perror("Peer accept failed");
-                continue;
+                if(errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                if(errno != EAGAIN && errno != EWOULDBLOCK)
+                    perror("Peer accept failed");
+                return;
             }
-            thread t(&PeerNode::handleIncomingConnection, this, clientSock);
-            t.detach();
+            char sender_ip[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &(clientAddr.sin_addr), sender_ip, INET_ADDRSTRLEN);
+            addConn(clientSock, sender_ip, false);
         }
-        close(listen_fd);
     }
 
-    void handleIncomingConnection(int sock) {
-        char buf[1024];
-        struct sockaddr_in addr;
-        socklen_t addr_len = sizeof(addr);
-        getpeername(sock, (struct sockaddr*)&addr, &addr_len);
-        char sender_ip[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &(addr.sin_addr), sender_ip, INET_ADDRSTRLEN);
-        
+    // Hands sock to the next I/O loop (round-robin). Outbound connections are entered in the
+    // neighbor table before the loop starts serving them. Called on the control loop.
+    ConnRef addConn(int sock, const string &addr, bool outbound) {
+        IoLoop *io = ioLoops[nextIo++ % ioLoops.size()].get();
+        PeerConn *conn = new PeerConn{sock, ++nextConnId, io, addr, outbound, OutboundQueue(outboundConfig),
+                                      false, false, FrameReader(), antiEntropyConfig.minCells, 0, 0, sockaddr_in(), {}, {},
+                                      nullptr};
+        conn->out.trackDelays(&io->queueDelays);
+        ConnRef ref{sock, io, conn->id};
+        if(outbound) {
+            conn->heard = heardStamp(addr);
+            neighborSock.update([&](unordered_map<string, ConnRef> &m) { m[addr] = ref; });
+        }
+        runOn(io, [this, conn] {
+            conn->io->conns[conn->fd] = conn;
+            conn->io->loop->add(conn->fd, EPOLLIN | EPOLLRDHUP | EPOLLET,
+                                [this, conn](uint32_t events) { connReady(conn, events); });
+        });
+        return ref;
+    }
+
+    // Returns the conn for a UDP endpoint, creating it on first contact; a dialed neighbor
+    // (outbound) is entered in the neighbor table. Control loop only.
+    ConnRef udpConn(const sockaddr_in &to, const string &addr, bool outbound) {
+        IoLoop *io = ioLoops[0].get();
+        PeerConn *&conn = udpConns[endpointKey(to)];
+        if(!conn) {
+            conn = new PeerConn{nextUdpHandle--, ++nextConnId, io, addr, outbound, OutboundQueue(outboundConfig),
+                                false, false, FrameReader(0), antiEntropyConfig.minCells, 0, 0, to, {}, {}, nullptr};
+            io->conns[conn->fd] = conn;
+            if(!outbound)
+                conn->heard = make_shared<atomic<int64_t>>(EventLoop::Clock::now().time_since_epoch().count());
+        } else if(outbound && !conn->outbound) {
+            conn->outbound = true; // it wrote to us first
+            conn->addr = addr;
+        }
+        if(outbound)
+            conn->heard = heardStamp(addr);
+        ConnRef ref{conn->fd, io, conn->id};
+        if(outbound)
+            neighborSock.update([&](unordered_map<string, ConnRef> &m) { m[addr] = ref; });
+        return ref;
+    }
+
+    // The shared last-heard stamp of an outbound neighbor. Control loop only.
+    shared_ptr<atomic<int64_t>> heardStamp(const string &addr) {
+        auto &stamp = heardFrom[addr];
+        if(!stamp)
+            stamp = make_shared<atomic<int64_t>>(0);
+        return stamp;
+    }
+
+    // Notes that conn delivered something: any frame shows the neighbor is alive.
+    static void heardOn(PeerConn *conn) {
+        if(conn->heard)
+            conn->heard->store(EventLoop::Clock::now().time_since_epoch().count(), memory_order_relaxed);
+    }
+
+    // For liveness: when a frame last arrived from the outbound neighbor nbr.
+    EventLoop::Clock::time_point lastHeardFrom(const string &nbr) {
+        auto it = heardFrom.find(nbr);
+        if(it == heardFrom.end())
+            return EventLoop::Clock::time_point();
+        return EventLoop::Clock::time_point(EventLoop::Clock::duration(it->second->load(memory_order_relaxed)));
+    }
+
+    // Runs fn on io's thread: immediately if already there, otherwise posted.
+    void runOn(IoLoop *io, function<void()> fn) {
+        if(io->loop->inLoopThread())
+            fn();
+        else
+            io->loop->post(move(fn));
+    }
+
+    // Like runOn(), but a posted fn runs ahead of the data work already posted to io.
+    void runUrgentOn(IoLoop *io, function<void()> fn) {
+        if(io->loop->inLoopThread())
+            fn();
+        else
+            io->loop->postUrgent(move(fn));
+    }
+
+    // Resolves a reference on its owning loop; nullptr if that connection has been closed.
+    PeerConn *findConn(IoLoop *io, int fd, uint64_t connId) {
+        auto it = io->conns.find(fd);
+        return it != io->conns.end() && it->second->id == connId ? it->second : nullptr;
+    }
+
+    // Unregisters and closes a connection (on its own loop). An outbound neighbor stays in
+    // neighborSock with fd -1 so its pings keep failing until it is reported dead.
+    void closeConn(PeerConn *conn) {
+        if(transport == Transport::Udp) {
+            udpConns.erase(endpointKey(conn->udpAddr));
+            udpAckDue.erase(remove(udpAckDue.begin(), udpAckDue.end(), conn), udpAckDue.end());
+        } else {
+            conn->io->loop->remove(conn->fd);
+            close(conn->fd);
+        }
+        conn->io->conns.erase(conn->fd);
+        if(conn->outbound) {
+            neighborSock.update([conn](unordered_map<string, ConnRef> &m) {
+                auto it = m.find(conn->addr);
+                if(it != m.end() && it->second.connId == conn->id)
+                    it->second.fd = -1;
+            });
+        }
+        delete conn;
+    }
+
+    // Edge-triggered: drains the socket until EAGAIN and handles every complete frame, the
+    // control frames of each read before its data frames.
+    void connReady(PeerConn *conn, uint32_t events) {
+        if(events & (EPOLLERR | EPOLLHUP)) {
+            closeConn(conn);
+            return;
+        }
+        if((events & EPOLLOUT) && !flushConn(conn))
+            return;
+        if(!(events & (EPOLLIN | EPOLLRDHUP)))
+            return;
         while(true) {
-            memset(buf, 0, sizeof(buf));
-            int bytes = read(sock, buf, sizeof(buf)-1);
-            if(bytes <= 0)
-                break;
-            buf[bytes] = '\0';
-            string recvMsg(buf);
-            
-            if(recvMsg.find("PING") == 0) {
-                string pong = "PONG";
-                if(send(sock, pong.c_str(), pong.size(), 0) < 0)
-                    perror("Error sending PONG");
-            } else if(recvMsg.find("PONG") == 0) {
-                // do nothing for PONG
-            } else { // gossip message
-                {
-                    lock_guard<mutex> lock(mtx);
-                    if(messageHistory.find(recvMsg) != messageHistory.end())
-                        continue;
-                    messageHistory.insert(recvMsg);
-                    
-                    string timestamp = getCurrentTimestamp();
-                    string logMsg = timestamp + " - Received new gossip from " + string(sender_ip) + ": " + recvMsg;
-                    cout << logMsg << endl;
-                    outputFile << logMsg << endl;
-                    forwardGossip(recvMsg, sock);
+            int bytes = read(conn->fd, conn->reader.writePtr(), conn->reader.writable());
+            if(bytes > 0) {
+                heardOn(conn);
+                conn->reader.commit(bytes);
+                bool open = conn->reader.consumeControlFirst([&](const FrameHeader &h, string_view payload) {
+                    return handleFrame(conn, h, payload);
+                });
+                if(!open) {
+                    if(conn->reader.error())
+                        closeConn(conn);
+                    return;
                 }
+                continue;
+            }
+            if(bytes < 0 && errno == EINTR)
+                continue;
+            if(bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                return;
+            closeConn(conn);
+            return;
+        }
+    }
+
+    // Returns false if conn was closed while handling the frame.
+    bool handleFrame(PeerConn *conn, const FrameHeader &h, string_view payload) {
+        switch(h.type) {
+        case MsgType::Ping: {
+            auto pong = FramePool::instance().acquire();
+            appendFrame(*pong, MsgType::Pong, myOriginId, h.seq, wallClockNs());
+            return queueSend(conn, move(pong));
+        }
+        case MsgType::Pong:
+            if(conn->outbound) {
+                string addr = conn->addr;
+                uint64_t nonce = h.seq;
+                runUrgentOn(ioLoops[0].get(), [this, addr, nonce] { liveness.onPong(addr, nonce); });
+            }
+            return true;
+        case MsgType::Gossip: {
+            forwardCounters.received++;
+            if(transport == Transport::Udp && udpConfig.retransmit) {
+                if(conn->acks.empty())
+                    udpAckDue.push_back(conn);
+                conn->acks.push_back(messageId(h.originId, h.seq)); // duplicates too: our ACK may have been lost
+                scheduleUdpFlush();
+            }
+            if(!messageHistory.checkAndInsert(messageId(h.originId, h.seq))) {
+                forwardCounters.duplicates++;
+                if(rumorConfig.mode == ForwardMode::Rumor &&
+                   rumors.duplicate(messageId(h.originId, h.seq), rumorConfig.stopAfterDuplicates))
+                    forwardCounters.killedByDuplicates++;
+                return true;
+            }
+            thread_local string logMsg; // keeps its capacity between messages
+            logMsg.clear();
+            appendTimestamp(logMsg);
+            logMsg += " - Received new gossip from ";
+            logMsg += conn->addr;
+            logMsg += ": ";
+            logMsg.append(payload);
+            logLine(logMsg);
+            uint64_t now = monotonicNs();
+            conn->io->propagation.record(h.originId, now > h.originTs ? now - h.originTs : 0, h.hops);
+            if(onGossipDelivered)
+                onGossipDelivered(h);
+            int senderSock = conn->fd;
+            uint64_t senderId = conn->id;
+            IoLoop *io = conn->io;
+            auto frame = FramePool::instance().acquire(FRAME_HEADER_SIZE + payload.size());
+            appendFrame(*frame, MsgType::Gossip, h.originId, h.seq, h.originTs, payload, 0,
+                        h.hops < 255 ? h.hops + 1 : 255);
+            recentMessages.insert(messageId(h.originId, h.seq), *frame);
+            forwardGossip(messageId(h.originId, h.seq), move(frame), senderId, io, h.hops);
+            return findConn(io, senderSock, senderId) != nullptr;
+        }
+        case MsgType::Digest:
+            return answerDigest(conn, h, payload);
+        case MsgType::Want:
+            return answerWant(conn, h, payload);
+        case MsgType::Ack:
+            parseIds(payload, conn->io->onlyTheirs);
+            for(uint64_t id : conn->io->onlyTheirs)
+                conn->unacked.erase(id);
+            return true;
+        default:
+            return true;
+        }
+    }
+
+    // Forwards a new gossip frame that reached us after `hops` hops (0 for our own) to the
+    // outbound neighbors other than the sender connection: all of them when flooding, or the
+    // first `fanout` of a random order in rumor mode, keeping the rest for later rounds.
+    void forwardGossip(uint64_t id, OutboundQueue::Frame frame, uint64_t senderId, IoLoop *current, unsigned hops) {
+        const auto &table = neighborSock.read(current->neighbors);
+        vector<ConnRef> &targets = current->forwardTargets;
+        targets.clear();
+        for(auto &entry : table)
+            if(entry.second.fd != -1 && entry.second.connId != senderId)
+                targets.push_back(entry.second);
+        forwardCounters.forwards++;
+        forwardCounters.floodFrames += targets.size();
+        forwardCounters.floodBytes += targets.size() * frame->size();
+        if(rumorConfig.mode == ForwardMode::Flood) {
+            sendGossip(frame, targets, current);
+            return;
+        }
+        if(hops >= (unsigned)rumorConfig.ttl) {
+            forwardCounters.ttlExpired++;
+            return;
+        }
+        shuffle(targets.begin(), targets.end(), current->rng);
+        size_t now = min(targets.size(), (size_t)fanout.load(memory_order_relaxed));
+        RumorTable<ConnRef>::Targets later(targets.begin() + now, targets.end()); // SlabPool memory
+        targets.resize(now);
+        if(!later.empty()) {
+            rumors.add(id, frame, move(later));
+            current->hotRumors.push_back(id);
+        }
+        sendGossip(frame, targets, current);
+    }
+
+    // One push round on io: every hot rumor goes to `fanout` more neighbors.
+    void rumorRound(IoLoop *io) {
+        size_t n = fanout.load(memory_order_relaxed);
+        vector<uint64_t> &stillHot = io->hotScratch;
+        vector<ConnRef> &targets = io->forwardTargets;
+        stillHot.clear();
+        OutboundQueue::Frame frame;
+        for(uint64_t id : io->hotRumors) {
+            if(!rumors.take(id, n, targets, frame))
+                continue;
+            sendGossip(frame, targets, io);
+            stillHot.push_back(id);
+        }
+        io->hotRumors.swap(stillHot);
+    }
+
+    // Control loop: adjusts the fanout to the duplicate rate seen since the last call.
+    void adaptFanout() {
+        uint64_t received = forwardCounters.received.load(), duplicates = forwardCounters.duplicates.load();
+        uint64_t r = received - lastAdaptReceived, d = duplicates - lastAdaptDuplicates;
+        lastAdaptReceived = received;
+        lastAdaptDuplicates = duplicates;
+        if(r == 0)
+            return;
+        double rate = (double)d / r;
+        int f = fanout.load();
+        if(rate > rumorConfig.targetDuplicateRate)
+            f = max(rumorConfig.minFanout, f - 1);
+        else if(rate < rumorConfig.targetDuplicateRate / 2)
+            f = min(rumorConfig.maxFanout, f + 1);
+        fanout = f;
+    }
+
+    // Queues a gossip frame for each target. Runs on `current`; neighbors served by other loops
+    // go through that loop's inbox, which one posted task drains. Every neighbor's queue shares
+    // the same copy of the frame.
+    void sendGossip(const OutboundQueue::Frame &frame, const vector<ConnRef> &targets, IoLoop *current) {
+        forwardCounters.framesSent += targets.size();
+        forwardCounters.bytesSent += targets.size() * frame->size();
+        vector<PeerConn*> &local = current->localTargets;
+        local.clear();
+        for(const ConnRef &r : targets) {
+            if(r.io != current)
+                sendVia(r, frame);
+            else if(PeerConn *c = findConn(current, r.fd, r.connId))
+                local.push_back(c);
+        }
+        for(PeerConn *c : local)
+            queueSend(c, frame);
+    }
+
+    // Hands a frame to a connection on another loop.
+    void sendVia(const ConnRef &r, const OutboundQueue::Frame &frame) {
+        IoLoop *io = r.io;
+        bool wake;
+        {
+            lock_guard<mutex> lock(io->inboxMtx);
+            wake = io->inbox.empty();
+            io->inbox.emplace_back(r, frame);
+        }
+        if(wake)
+            io->loop->post([this, io] { drainInbox(io); });
+    }
+
+    void drainInbox(IoLoop *io) {
+        {
+            lock_guard<mutex> lock(io->inboxMtx);
+            io->inboxBatch.swap(io->inbox);
+        }
+        for(auto &entry : io->inboxBatch)
+            if(PeerConn *c = findConn(io, entry.first.fd, entry.first.connId))
+                queueSend(c, move(entry.second));
+        io->inboxBatch.clear();
+    }
+
+    // Queues a frame on the connection. The write of data frames is deferred to the end of the
+    // current loop pass, so all frames queued while handling one batch of events leave in one
+    // scatter-gather write per connection. Control frames (PING/PONG) go into the queue's
+    // priority lane, are never dropped, and are written at once unless the socket is full.
+    // Returns false if the queue overflowed under SlowPolicy::Disconnect and the connection
+    // was closed.
+    bool queueSend(PeerConn *conn, OutboundQueue::Frame frame) {
+        if(transport == Transport::Udp) {
+            queueDatagram(conn, move(frame));
+            return true;
+        }
+        TrafficClass cls = trafficClassOf(*frame);
+        if(!conn->out.push(move(frame), cls)) {
+            thread_local string logMsg; // keeps its capacity between disconnects
+            logMsg.clear();
+            logMsg += "Peer ";
+            logMsg += myIP;
+            logMsg += ':';
+            logMsg += myPort;
+            logMsg += " - disconnecting slow neighbor ";
+            logMsg += conn->addr;
+            logMsg += " (";
+            conn->out.appendSummary(logMsg);
+            logMsg += ')';
+            logLine(logMsg);
+            closeConn(conn);
+            return false;
+        }
+        if(cls == TrafficClass::Control && !conn->wantWrite)
+            return flushConn(conn);
+        if(!conn->flushScheduled && !conn->wantWrite) {
+            conn->flushScheduled = true;
+            IoLoop *io = conn->io;
+            if(io->pendingFlush.empty())
+                io->loop->defer([this, io] { flushPending(io); });
+            io->pendingFlush.push_back({conn->fd, io, conn->id});
+        }
+        return true;
+    }
+
+    // End of a loop pass: flushes every connection that queued frames during it.
+    void flushPending(IoLoop *io) {
+        io->flushBatch.swap(io->pendingFlush);
+        for(const ConnRef &r : io->flushBatch) {
+            if(PeerConn *c = findConn(io, r.fd, r.connId)) {
+                c->flushScheduled = false;
+                flushConn(c);
             }
         }
-        close(sock);
+        io->flushBatch.clear();
     }
 
-    void forwardGossip(const string &msg, int senderSock) {
-        lock_guard<mutex> lock(mtx);
-        for(auto &entry : neighborSock) {
-            int s = entry.second;
-            if(s != senderSock)
-                send(s, msg.c_str(), msg.size(), 0);
+    // Writes as much of the queue as the socket accepts and arms EPOLLOUT for the rest.
+    bool flushConn(PeerConn *conn) {
+        if(conn->out.flush(conn->fd) == OutboundQueue::FlushResult::Error) {
+            perror("Error sending to peer");
+            closeConn(conn);
+            return false;
         }
+        bool wantWrite = !conn->out.empty();
+        if(wantWrite != conn->wantWrite) {
+            conn->wantWrite = wantWrite;
+            conn->io->loop->modify(conn->fd, EPOLLIN | EPOLLRDHUP | EPOLLET | (wantWrite ? (uint32_t)EPOLLOUT : 0u));
+        }
+        return true;
     }
 
     // ------------------------------
-    // Outgoing Connections & Registration
+    // UDP transport
     // ------------------------------
-    int connectToPeer(const string &peerIP, const string &peerPort) {
-        int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-        if(sockfd < 0) {
-            perror("socket() failed in connectToPeer");
-            return -1;
+    void openDatagramSocket() {
+        udp.configure(udpConfig);
+        udp.trackDelays(&ioLoops[0]->queueDelays);
+        if(!udp.open(myIP, atoi(myPort.c_str()))) {
+            perror("Peer UDP socket failed");
+            exit(EXIT_FAILURE);
         }
-        // Set nonblocking mode.
-        int flags = fcntl(sockfd, F_GETFL, 0);
-        fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
-        struct sockaddr_in servAddr;
-        memset(&servAddr, 0, sizeof(servAddr));
-        servAddr.sin_family = AF_INET;
-        servAddr.sin_port = htons(atoi(peerPort.c_str()));
-        if(inet_pton(AF_INET, peerIP.c_str(), &servAddr.sin_addr) <= 0) {
-            cerr << "Invalid address in connectToPeer" << endl;
-            close(sockfd);
-            return -1;
+        // A digest has to fit in one datagram.
+        size_t fit = (DatagramSocket::MAX_DATAGRAM - FRAME_HEADER_SIZE - 4) / Iblt::CELL_BYTES / Iblt::HASHES * Iblt::HASHES;
+        antiEntropyConfig.maxCells = min(antiEntropyConfig.maxCells, fit);
+        antiEntropyConfig.minCells = min(antiEntropyConfig.minCells, antiEntropyConfig.maxCells);
+        cout << "Peer listening on " << myIP << ":" << myPort << " (udp)" << endl;
+        loop.add(udp.fd(), EPOLLIN | EPOLLET, [this](uint32_t events) { udpReady(events); });
+        loop.post([this] {
+            if(udpConfig.retransmit)
+                retransmitTimer = loop.runEvery(max(udpConfig.rto / 2, chrono::milliseconds(1)),
+                                                [this] { retransmitDue(); });
+            udpIdleTimer = loop.runEvery(max<chrono::milliseconds>(udpConfig.idleTimeout / 2, chrono::seconds(1)),
+                                         [this] { expireUdpConns(); });
+        });
+    }
+
+    // Forgets inbound UDP endpoints silent for idleTimeout, so peers that wrote to us once and
+    // left do not keep a conn each. Outbound neighbors are left to liveness and DEAD reports.
+    void expireUdpConns() {
+        int64_t cutoff = (EventLoop::Clock::now() - udpConfig.idleTimeout).time_since_epoch().count();
+        vector<PeerConn*> idle;
+        for(auto &entry : udpConns)
+            if(!entry.second->outbound && entry.second->heard->load(memory_order_relaxed) < cutoff)
+                idle.push_back(entry.second);
+        for(PeerConn *conn : idle)
+            closeConn(conn);
+        udpCounters.expired += idle.size();
+    }
+
+    void udpReady(uint32_t events) {
+        if(events & EPOLLOUT)
+            flushUdp();
+        if(!(events & EPOLLIN))
+            return;
+        udp.receive([this](const sockaddr_in &from, const FrameHeader &h, string_view payload) {
+            auto it = udpConns.find(endpointKey(from));
+            PeerConn *conn = it != udpConns.end() ? it->second : nullptr;
+            if(!conn) {
+                char ip[INET_ADDRSTRLEN];
+                inet_ntop(AF_INET, &from.sin_addr, ip, sizeof(ip));
+                ConnRef r = udpConn(from, string(ip) + ":" + to_string(ntohs(from.sin_port)), false);
+                conn = findConn(r.io, r.fd, r.connId);
+            }
+            heardOn(conn);
+            handleFrame(conn, h, payload);
+        });
+    }
+
+    // Hands a frame to the datagram socket; gossip is remembered for retransmission. Control
+    // frames are sent at once, like on TCP.
+    void queueDatagram(PeerConn *conn, OutboundQueue::Frame frame) {
+        bool control = trafficClassOf(*frame) == TrafficClass::Control;
+        if(udpConfig.retransmit && (MsgType)(uint8_t)(*frame)[0] == MsgType::Gossip) {
+            FrameHeader h = decodeHeader(frame->data());
+            conn->unacked[messageId(h.originId, h.seq)] = {frame, 0, chrono::steady_clock::now() + udpConfig.rto};
         }
-        int ret = connect(sockfd, (struct sockaddr*)&servAddr, sizeof(servAddr));
-        if(ret < 0 && errno != EINPROGRESS) {
-            perror("Connect failed in connectToPeer");
-            close(sockfd);
-            return -1;
-        }
-        // Wait for connection in nonblocking mode.
-        fd_set wfds;
-        FD_ZERO(&wfds);
-        FD_SET(sockfd, &wfds);
-        struct timeval tv = {5, 0};  // 5-second timeout
-        int sel = select(sockfd+1, nullptr, &wfds, nullptr, &tv);
-        if(sel <= 0) {
-            cerr << "Connection timeout for peer " << peerIP << ":" << peerPort << endl;
-            close(sockfd);
-            return -1;
+        udp.queue(conn->udpAddr, move(frame));
+        if(control && !udpWantWrite)
+            flushUdp();
+        else
+            scheduleUdpFlush();
+    }
+
+    // Like queueSend() for TCP: everything queued in one loop pass leaves in one flush.
+    void scheduleUdpFlush() {
+        if(udpFlushScheduled || udpWantWrite)
+            return;
+        udpFlushScheduled = true;
+        loop.defer([this] {
+            udpFlushScheduled = false;
+            flushUdp();
+        });
+    }
+
+    void flushUdp() {
+        for(PeerConn *conn : udpAckDue) {
+            string &ids = conn->io->payloadScratch;
+            ids.clear();
+            appendIds(ids, conn->acks);
+            auto ack = FramePool::instance().acquire(FRAME_HEADER_SIZE + ids.size());
+            appendFrame(*ack, MsgType::Ack, myOriginId, 0, wallClockNs(), ids);
+            udp.queue(conn->udpAddr, move(ack));
+            udpCounters.acksSent++;
+            conn->acks.clear();
+        }
+        udpAckDue.clear();
+        bool wantWrite = udp.flush() == DatagramSocket::FlushResult::Blocked;
+        if(wantWrite != udpWantWrite) {
+            udpWantWrite = wantWrite;
+            loop.modify(udp.fd(), EPOLLIN | EPOLLET | (wantWrite ? (uint32_t)EPOLLOUT : 0u));
+        }
+    }
+
+    // Resends gossip whose ACK is overdue, doubling the timeout per attempt; gives up after
+    // maxRetries (anti-entropy still repairs the gap).
+    void retransmitDue() {
+        auto now = chrono::steady_clock::now();
+        bool queued = false;
+        for(auto &entry : ioLoops[0]->conns) {
+            PeerConn *conn = entry.second;
+            for(auto it = conn->unacked.begin(); it != conn->unacked.end();) {
+                PeerConn::Unacked &u = it->second;
+                if(now < u.deadline) {
+                    ++it;
+                    continue;
+                }
+                if(u.attempts >= udpConfig.maxRetries) {
+                    udpCounters.gaveUp++;
+                    it = conn->unacked.erase(it);
+                    continue;
+                }
+                u.attempts++;
+                u.deadline = now + udpConfig.rto * (1 << u.attempts);
+                udp.queue(conn->udpAddr, u.frame);
+                udpCounters.retransmits++;
+                queued = true;
+                ++it;
+            }
         }
-        // Restore socket to blocking mode.
-        flags = fcntl(sockfd, F_GETFL, 0);
-        fcntl(sockfd, F_SETFL, flags & ~O_NONBLOCK);
-        return sockfd;
+        if(queued)
+            scheduleUdpFlush();
+    }
+
+    // "transport udp datagrams_sent=... retransmits=<n> gave_up=<n> acks_sent=<n> expired=<n>", or
+    // "transport tcp".
+    string transportSummary() {
+        ostringstream oss;
+        oss << "Peer " << myIP << ":" << myPort << " - transport ";
+        if(transport == Transport::Tcp)
+            oss << "tcp";
+        else
+            oss << udp.summary() << " retransmits=" << udpCounters.retransmits << " gave_up=" << udpCounters.gaveUp
+                << " acks_sent=" << udpCounters.acksSent << " expired=" << udpCounters.expired;
+        return oss.str();
     }
 
+    // ------------------------------
+    // Outgoing Connections & Registration
+    // ------------------------------
+    // Bootstrap progress. Created by registerWithSeeds(), then owned by the loop thread until
+    // `finished` is set.
+    struct Bootstrap {
+        chrono::steady_clock::time_point started;
+        size_t seedsPending = 0;
+        vector<string> candidates;          // union of peer lists; duplicates bias high-degree peers
+        bool fixedNeighbors = false;        // candidates given by registerWithTopology()
+        size_t nextCandidate = 0;
+        unordered_set<string> tried;
+        unordered_map<int, string> dialing; // in-progress connect() fd -> "IP:Port"
+        vector<string> connected;
+        int dialsFailed = 0;
+        bool dialStarted = false;
+        bool done = false;
+        EventLoop::TimerId seedTimer = 0;
+        EventLoop::TimerId deadlineTimer = 0;
+        double firstNeighborMs = -1;        // time to first neighbor, -1 if none
+        double totalMs = 0;
+        mt19937 rng{random_device{}()};
+        promise<void> finished;
+    };
+    unique_ptr<Bootstrap> bootstrap;
+
     // Registers with a random subset of seeds (floor(n/2)+1) and retrieves union of their peer lists
-    // to select up to 3 neighbors using a weighted (preferential) method.
+    // to select up to 3 neighbors using a weighted (preferential) method. All seeds are queried and
+    // all candidate neighbors are dialed concurrently on the loop under one overall deadline; a
+    // candidate that fails is replaced by the next one from the accumulated list. Blocks until the
+    // neighbors are connected, the candidates run out, or the deadline passes.
     void registerWithSeeds() {
         int n = allSeeds.size();
         int required = (n / 2) + 1;
         vector<pair<string,int>> seedsCopy = allSeeds;
-        random_device rd;
-        mt19937 g(rd());
-        shuffle(seedsCopy.begin(), seedsCopy.end(), g);
+        bootstrap = make_unique<Bootstrap>();
+        bootstrap->started = chrono::steady_clock::now();
+        shuffle(seedsCopy.begin(), seedsCopy.end(), bootstrap->rng);
         seedsCopy.resize(required);
         chosenSeeds = seedsCopy;
-        // Accumulate peers (allow duplicates) from chosen seeds.
-        vector<string> accumulatedPeers;
+        runBootstrap();
+    }
+
+    // Joins a fixed overlay, such as one from a topology file: registers with exactly `seeds`
+    // and dials exactly `neighbors` ("IP:Port"), ignoring the seeds' peer lists. Blocks like
+    // registerWithSeeds(); a neighbor that cannot be reached within the deadline is left out.
+    void registerWithTopology(const vector<pair<string,int>> &seeds, const vector<string> &neighbors) {
+        bootstrap = make_unique<Bootstrap>();
+        bootstrap->started = chrono::steady_clock::now();
+        bootstrap->fixedNeighbors = true;
+        bootstrap->candidates = neighbors;
+        bootstrapConfig.targetNeighbors = neighbors.size();
+        chosenSeeds = seeds;
+        runBootstrap();
+    }
+
+    void runBootstrap() {
+        future<void> finished = bootstrap->finished.get_future();
+        loop.post([this] { startBootstrap(); });
+        finished.wait();
+        ostringstream oss;
+        oss << "Peer " << myIP << ":" << myPort << " - Connected neighbors: ";
+        for(auto &nbr : bootstrap->connected)
+            oss << nbr << " ";
+        logLine(oss.str());
+        logLine(bootstrapSummary());
+    }
+
+    // "bootstrap neighbors=<n>/<target> dialed=<n> failed=<n> first_neighbor_ms=<t> total_ms=<t>"
+    string bootstrapSummary() {
+        ostringstream oss;
+        oss << "Peer " << myIP << ":" << myPort << " - bootstrap neighbors=" << bootstrap->connected.size()
+            << "/" << bootstrapConfig.targetNeighbors << " dialed=" << bootstrap->tried.size()
+            << " failed=" << bootstrap->dialsFailed << " first_neighbor_ms=" << bootstrap->firstNeighborMs
+            << " total_ms=" << bootstrap->totalMs;
+        return oss.str();
+    }
+
+    // Opens a session per chosen seed and asks each for its peer list. Dialing starts once every
+    // seed has answered or after seedWait, whichever comes first.
+    void startBootstrap() {
+        Bootstrap &b = *bootstrap;
+        string self = myIP + ":" + myPort;
+        b.seedsPending = chosenSeeds.size();
+        b.deadlineTimer = loop.runAfter(bootstrapConfig.deadline, [this] { finishBootstrap(); });
+        b.seedTimer = loop.runAfter(bootstrapConfig.seedWait, [this] { beginDialing(); });
         for(auto &seed : chosenSeeds) {
-            int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-            if(sockfd < 0) { perror("Socket failed for seed registration"); continue; }
-            struct sockaddr_in servAddr;
-            memset(&servAddr, 0, sizeof(servAddr));
-            servAddr.sin_family = AF_INET;
-            servAddr.sin_port = htons(seed.second);
-            if(inet_pton(AF_INET, seed.first.c_str(), &servAddr.sin_addr) <= 0) {
-                cerr << "Invalid seed address " << seed.first << endl;
-                close(sockfd);
-                continue;
-            }
-            if(connect(sockfd, (struct sockaddr*)&servAddr, sizeof(servAddr)) < 0) {
-                perror("Connect failed for seed registration");
-                close(sockfd);
+            seedSessions.push_back(make_unique<SeedSession>(loop, seed.first, seed.second, myOriginId));
+            SeedSession *session = seedSessions.back().get();
+            session->registerPeer(self);
+            if(b.fixedNeighbors)
                 continue;
-            }
-            // Send REGISTER.
-            string regCmd = "REGISTER " + myIP + " " + myPort;
-            send(sockfd, regCmd.c_str(), regCmd.size(), 0);
-            // Send GET_PEERS.
-            string getCmd = "GET_PEERS";
-            send(sockfd, getCmd.c_str(), getCmd.size(), 0);
-            char buffer[1024] = {0};
-            int len = read(sockfd, buffer, sizeof(buffer)-1);
-            if(len > 0) {
-                buffer[len] = '\0';
-                string peersStr(buffer);
-                istringstream iss(peersStr);
+            session->getPeers([this, self](string_view payload) {
+                Bootstrap &b = *bootstrap;
+                if(b.dialStarted)
+                    return; // late reply; the seed session stays up for DEAD reports
+                istringstream iss{string(payload)};
                 string token;
-                while(getline(iss, token, ',')) {
-                    if(token != (myIP + ":" + myPort) && !token.empty())
-                        accumulatedPeers.push_back(token);
-                }
-            }
-            else {
-                cerr << "Failed to read peer list from seed " << seed.first << ":" << seed.second << endl;
-            }
+                while(getline(iss, token, ','))
+                    if(token != self && !token.empty())
+                        b.candidates.push_back(token);
+                if(--b.seedsPending == 0)
+                    beginDialing();
+            });
+        }
+        if(chosenSeeds.empty() || b.fixedNeighbors)
+            beginDialing();
+    }
+
+    void beginDialing() {
+        Bootstrap &b = *bootstrap;
+        if(b.dialStarted || b.done)
+            return;
+        b.dialStarted = true;
+        loop.cancel(b.seedTimer);
+        // Preferential attachment: duplicates in candidates increase chance of selection.
+        if(!b.fixedNeighbors)
+            shuffle(b.candidates.begin(), b.candidates.end(), b.rng);
+        fillDials();
+    }
+
+    // Keeps targetNeighbors connects in flight (or done) while untried candidates remain.
+    void fillDials() {
+        Bootstrap &b = *bootstrap;
+        while(!b.done && b.connected.size() + b.dialing.size() < (size_t)bootstrapConfig.targetNeighbors
+              && b.nextCandidate < b.candidates.size()) {
+            const string nbr = b.candidates[b.nextCandidate++];
+            if(!b.tried.insert(nbr).second)
+                continue;
+            dialPeer(nbr);
+        }
+        if(!b.done && b.dialing.empty())
+            finishBootstrap();
+    }
+
+    // Starts a nonblocking connect to "IP:Port"; the result is handled by dialReady().
+    void dialPeer(const string &nbr) {
+        Bootstrap &b = *bootstrap;
+        string peerIP, peerPort;
+        struct sockaddr_in servAddr;
+        memset(&servAddr, 0, sizeof(servAddr));
+        servAddr.sin_family = AF_INET;
+        if(!splitHostPort(nbr, peerIP, peerPort) || inet_pton(AF_INET, peerIP.c_str(), &servAddr.sin_addr) <= 0) {
+            cerr << "Invalid neighbor address " << nbr << endl;
+            b.dialsFailed++;
+            return;
+        }
+        servAddr.sin_port = htons(atoi(peerPort.c_str()));
+        if(transport == Transport::Udp) {
+            neighborReady(nbr, udpConn(servAddr, nbr, true));
+            return;
+        }
+        int sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if(sockfd < 0) {
+            perror("socket() failed in dialPeer");
+            b.dialsFailed++;
+            return;
+        }
+        if(connect(sockfd, (struct sockaddr*)&servAddr, sizeof(servAddr)) < 0 && errno != EINPROGRESS) {
+            cerr << "Connect failed for peer " << nbr << ": " << strerror(errno) << endl;
             close(sockfd);
+            b.dialsFailed++;
+            return;
         }
-        // Preferential attachment: duplicates in accumulatedPeers increase chance of selection.
-        unordered_set<string> selectedNeighbors;
-        shuffle(accumulatedPeers.begin(), accumulatedPeers.end(), g);
-        for(auto &p : accumulatedPeers) {
-            if(selectedNeighbors.find(p) == selectedNeighbors.end()) {
-                selectedNeighbors.insert(p);
-                if(selectedNeighbors.size() >= 3)
-                    break;
-            }
+        b.dialing[sockfd] = nbr;
+        loop.add(sockfd, EPOLLOUT | EPOLLET, [this, sockfd](uint32_t) { dialReady(sockfd); });
+    }
+
+    void dialReady(int sockfd) {
+        Bootstrap &b = *bootstrap;
+        auto it = b.dialing.find(sockfd);
+        if(it == b.dialing.end())
+            return;
+        string nbr = it->second;
+        b.dialing.erase(it);
+        loop.remove(sockfd);
+        int soError = 0;
+        socklen_t soLen = sizeof(soError);
+        getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &soError, &soLen);
+        if(soError != 0) {
+            cerr << "Connection failed for peer " << nbr << ": " << strerror(soError) << endl;
+            close(sockfd);
+            b.dialsFailed++;
+        } else {
+            neighborReady(nbr, addConn(sockfd, nbr, true));
         }
-        {
-            lock_guard<mutex> lock(mtx);
-            for(auto &nbr : selectedNeighbors)
-                connectedNeighbors.insert(nbr);
-        }
-        // Establish outgoing connections.
-        for(auto &nbr : connectedNeighbors) {
-            size_t pos = nbr.find(":");
-            if(pos == string::npos) continue;
-            string peerIP = nbr.substr(0, pos);
-            string peerPort = nbr.substr(pos+1);
-            int sock = connectToPeer(peerIP, peerPort);
-            if(sock != -1) {
-                lock_guard<mutex> lock(mtx);
-                neighborSock[nbr] = sock;
-                pingFailures[nbr] = 0;
-            }
+        fillDials();
+    }
+
+    void neighborReady(const string &nbr, ConnRef ref) {
+        Bootstrap &b = *bootstrap;
+        if(b.connected.empty())
+            b.firstNeighborMs = chrono::duration<double, milli>(chrono::steady_clock::now() - b.started).count();
+        b.connected.push_back(nbr);
+        connectedNeighbors.insert(nbr);
+        liveness.addNeighbor(nbr);
+        if(antiEntropyStarted)
+            reconcileWith(ref); // catch up with what the neighbor saw before we connected
+    }
+
+    // Ends the bootstrap: abandons connects still in flight and wakes registerWithSeeds().
+    void finishBootstrap() {
+        Bootstrap &b = *bootstrap;
+        if(b.done)
+            return;
+        b.done = true;
+        loop.cancel(b.seedTimer);
+        loop.cancel(b.deadlineTimer);
+        for(auto &entry : b.dialing) {
+            cerr << "Connection timeout for peer " << entry.second << endl;
+            loop.remove(entry.first);
+            close(entry.first);
+            b.dialsFailed++;
         }
-        ostringstream oss;
-        oss << "Peer " << myIP << ":" << myPort << " - Connected neighbors: ";
-        for(auto &nbr : connectedNeighbors)
-            oss << nbr << " ";
-        cout << oss.str() << endl;
-        outputFile << oss.str() << endl;
+        b.dialing.clear();
+        b.totalMs = chrono::duration<double, milli>(chrono::steady_clock::now() - b.started).count();
+        b.finished.set_value();
     }
 
     // ------------------------------
     // Gossip Generation & Forwarding
     // ------------------------------
-    // Generates 10 gossip messages (every 5 seconds) in the format:
+    // Schedules 10 gossip messages (one now, then every 5 seconds) on the loop, in the format:
     // <timestamp>:<self.IP>:Msg#<number>
     void generateGossip() {
-        for (int i = 1; i <= 10; i++) {
-            string timestamp = getCurrentTimestamp();
-            string message = timestamp + ":" + myIP + ":Msg#" + to_string(i);
-            cout << message << endl;
-            outputFile << message << endl;
-            {
-                lock_guard<mutex> lock(mtx);
-                messageHistory.insert(message);
+        loop.post([this] {
+            emitGossip();
+            gossipTimer = loop.runEvery(chrono::seconds(5), [this] {
+                if(emitGossip() >= 10)
+                    loop.cancel(gossipTimer);
+            });
+        });
+    }
+
+    // Sends the next gossip message to every neighbor and returns its number.
+    int emitGossip() {
+        gossipCount++;
+        thread_local string message;
+        message.clear();
+        appendTimestamp(message);
+        message += ':';
+        message += myIP;
+        message += ":Msg#";
+        char count[16];
+        message.append(count, snprintf(count, sizeof(count), "%d", gossipCount));
+        logLine(message);
+        uint64_t seq = incarnation | (uint32_t)gossipCount;
+        messageHistory.checkAndInsert(messageId(myOriginId, seq));
+        auto frame = FramePool::instance().acquire();
+        appendFrame(*frame, MsgType::Gossip, myOriginId, seq, monotonicNs(), message, 0, 1);
+        recentMessages.insert(messageId(myOriginId, seq), *frame);
+        forwardGossip(messageId(myOriginId, seq), move(frame), 0, ioLoops[0].get(), 0);
+        return gossipCount;
+    }
+
+    // ------------------------------
+    // Anti-entropy
+    // ------------------------------
+    // Starts a reconciliation round with every outbound neighbor now and every
+    // antiEntropyConfig.interval; neighbors connected later get their first round at once.
+    void startAntiEntropy() {
+        loop.post([this] {
+            antiEntropyStarted = true;
+            antiEntropyTimer = loop.runEvery(antiEntropyConfig.interval, [this] { reconcileAll(); });
+            reconcileAll();
+        });
+    }
+
+    void reconcileAll() {
+        auto table = neighborSock.read();
+        for(auto &entry : *table)
+            if(entry.second.fd != -1)
+                reconcileWith(entry.second);
+    }
+
+    // Begins a round on the loop owning the connection. A table grown by retries in the last
+    // round is halved, so a one-off catch-up does not keep every later digest large.
+    // Called inline when r is on the caller's loop, so the common single-loop case builds no task.
+    void reconcileWith(ConnRef r) {
+        if(!r.io->loop->inLoopThread()) {
+            r.io->loop->post([this, r] { reconcileWith(r); });
+            return;
+        }
+        if(PeerConn *c = findConn(r.io, r.fd, r.connId)) {
+            c->digestCells = max(antiEntropyConfig.minCells, c->digestCells / 2);
+            c->digestRound++;
+            c->digestRetries = 0;
+            sendDigest(c);
+        }
+    }
+
+    // Returns false if conn was closed.
+    bool sendDigest(PeerConn *conn) {
+        size_t setSize;
+        Iblt &table = conn->io->digestMine;
+        recentMessages.digest(table, conn->digestCells, setSize);
+        string &payload = conn->io->payloadScratch;
+        payload.clear();
+        appendDigestPayload(payload, setSize, table);
+        auto frame = FramePool::instance().acquire(FRAME_HEADER_SIZE + payload.size());
+        appendFrame(*frame, MsgType::Digest, myOriginId, conn->digestRound, wallClockNs(), payload);
+        antiEntropyCounters.digestsSent++;
+        return queueSend(conn, move(frame));
+    }
+
+    // Pushes the gossip the digest's sender lacks and asks it for what we lack. A digest too
+    // small for the difference (judged from the set sizes, or by failing to decode) is answered
+    // with FRAME_RETRY and a larger table size instead.
+    bool answerDigest(PeerConn *conn, const FrameHeader &h, string_view payload) {
+        IoLoop *io = conn->io;
+        size_t theirSize, mySize;
+        Iblt &theirs = io->digestTheirs, &mine = io->digestMine;
+        if(!parseDigestPayload(payload, theirSize, theirs))
+            return true;
+        antiEntropyCounters.digestsAnswered++;
+        size_t cells = theirs.cells();
+        recentMessages.digest(mine, cells, mySize);
+        size_t need = min(antiEntropyConfig.maxCells,
+                          Iblt::cellsFor(mySize > theirSize ? mySize - theirSize : theirSize - mySize));
+        vector<uint64_t> &onlyMine = io->onlyMine, &onlyTheirs = io->onlyTheirs;
+        onlyMine.clear();
+        onlyTheirs.clear();
+        bool decoded = false;
+        if(need <= cells) {
+            mine.subtract(theirs);
+            decoded = mine.decode(onlyMine, onlyTheirs);
+        }
+        if(!decoded) {
+            if(cells >= antiEntropyConfig.maxCells) {
+                antiEntropyCounters.decodeFailures++;
+                return true;
+            }
+            uint32_t retryCells = htobe32((uint32_t)max(need, min(antiEntropyConfig.maxCells, cells * 2)));
+            auto retry = FramePool::instance().acquire();
+            appendFrame(*retry, MsgType::Want, myOriginId, h.seq, wallClockNs(),
+                        string_view((const char *)&retryCells, 4), FRAME_RETRY);
+            antiEntropyCounters.retries++;
+            return queueSend(conn, move(retry));
+        }
+        for(uint64_t id : onlyMine) {
+            if(auto frame = recentMessages.find(id)) {
+                antiEntropyCounters.pushed++;
+                if(!queueSend(conn, move(frame)))
+                    return false;
             }
-            lock_guard<mutex> lock(mtx);
-            for(auto &entry : neighborSock) {
-                int sock = entry.second;
-                if(send(sock, message.c_str(), message.size(), 0) < 0)
-                    perror("Error sending gossip message");
+        }
+        if(onlyTheirs.empty())
+            return true;
+        string &ids = io->payloadScratch;
+        ids.clear();
+        appendIds(ids, onlyTheirs);
+        auto want = FramePool::instance().acquire(FRAME_HEADER_SIZE + ids.size());
+        appendFrame(*want, MsgType::Want, myOriginId, h.seq, wallClockNs(), ids);
+        antiEntropyCounters.wanted += onlyTheirs.size();
+        return queueSend(conn, move(want));
+    }
+
+    // Re-sends requested gossip, or repeats the current round with the table size asked for.
+    bool answerWant(PeerConn *conn, const FrameHeader &h, string_view payload) {
+        if(h.flags & FRAME_RETRY) {
+            if(h.seq != conn->digestRound || payload.size() < 4 ||
+               ++conn->digestRetries > antiEntropyConfig.maxRetries)
+                return true;
+            uint32_t cells;
+            memcpy(&cells, payload.data(), 4);
+            conn->digestCells = min<size_t>(max<size_t>(be32toh(cells), antiEntropyConfig.minCells),
+                                            antiEntropyConfig.maxCells);
+            return sendDigest(conn);
+        }
+        parseIds(payload, conn->io->onlyTheirs);
+        for(uint64_t id : conn->io->onlyTheirs) {
+            if(auto frame = recentMessages.find(id)) {
+                antiEntropyCounters.served++;
+                if(!queueSend(conn, move(frame)))
+                    return false;
             }
-            this_thread::sleep_for(chrono::seconds(5));
         }
+        return true;
+    }
+
+    string antiEntropySummary() {
+        auto &c = antiEntropyCounters;
+        ostringstream oss;
+        oss << "Peer " << myIP << ":" << myPort << " - anti_entropy recent=" << recentMessages.size()
+            << " digests_sent=" << c.digestsSent << " digests_answered=" << c.digestsAnswered
+            << " retries=" << c.retries << " decode_failures=" << c.decodeFailures << " pushed=" << c.pushed
+            << " wanted=" << c.wanted << " served=" << c.served;
+        return oss.str();
     }
 
     // ------------------------------
     // Liveness (Ping/Pong) Check
     // ------------------------------
+    // Starts the per-neighbor ping timers on the loop. Each neighbor is pinged every 13 seconds
+    // (first pings staggered across the interval) with an RTO that backs off per miss. A miss
+    // counts only if nothing else arrived from the neighbor in the last interval either, and
+    // 3 consecutive counted misses report it dead.
     void checkLiveness() {
-        while(true) {
-            this_thread::sleep_for(chrono::seconds(13));
-            lock_guard<mutex> lock(mtx);
-            vector<string> neighs;
-            for(auto &entry : neighborSock)
-                neighs.push_back(entry.first);
-            for(auto &nbr : neighs) {
-                int sock = neighborSock[nbr];
-                string pingMsg = "PING";
-                if(send(sock, pingMsg.c_str(), pingMsg.size(), 0) < 0)
-                    perror("Error sending PING");
-                int flags = fcntl(sock, F_GETFL, 0);
-                fcntl(sock, F_SETFL, flags | O_NONBLOCK);
-                char reply[64] = {0};
-                int n = recv(sock, reply, sizeof(reply)-1, MSG_DONTWAIT);
-                fcntl(sock, F_SETFL, flags); // Restore flags
-                if(n <= 0) {
-                    pingFailures[nbr]++;
-                    if(pingFailures[nbr] >= 3)
-                        reportDeadNeighbor(nbr, sock);
-                } else {
-                    reply[n] = '\0';
-                    string rpl(reply);
-                    if(rpl.find("PONG") == 0)
-                        pingFailures[nbr] = 0;
-                }
-            }
+        loop.post([this] { liveness.start(); });
+    }
+
+    // Sends a PING carrying nonce; false if the neighbor's connection is known to be gone. A
+    // connection on another loop gets the PING posted; if it has closed meanwhile the PING
+    // simply times out.
+    bool sendPing(const string &nbr, uint64_t nonce) {
+        const auto &table = neighborSock.read(ioLoops[0]->neighbors);
+        auto it = table.find(nbr);
+        if(it == table.end() || it->second.fd == -1)
+            return false;
+        ConnRef r = it->second;
+        auto ping = FramePool::instance().acquire();
+        appendFrame(*ping, MsgType::Ping, myOriginId, nonce, wallClockNs());
+        if(r.io == ioLoops[0].get()) {
+            PeerConn *c = findConn(r.io, r.fd, r.connId);
+            return c && queueSend(c, move(ping));
         }
+        r.io->loop->postUrgent([this, r, ping] {
+            if(PeerConn *c = findConn(r.io, r.fd, r.connId))
+                queueSend(c, ping);
+        });
+        return true;
+    }
+
+    // RTT and probe counters for every neighbor; safe to call from any thread.
+    string livenessSummary() {
+        promise<string> result;
+        auto future = result.get_future();
+        loop.post([this, &result] { result.set_value(liveness.summary()); });
+        return future.get();
+    }
+
+    // Latency and hop histograms of all gossip received so far, merged across the I/O loops;
+    // safe to call from any thread other than an I/O loop.
+    PropagationStats propagationStats() {
+        PropagationStats merged;
+        for(auto &ioPtr : ioLoops) {
+            IoLoop *io = ioPtr.get();
+            promise<PropagationStats> result;
+            auto future = result.get_future();
+            io->loop->post([io, &result] { result.set_value(io->propagation); });
+            merged.merge(future.get());
+        }
+        return merged;
+    }
+
+    string propagationSummary() {
+        return "Peer " + myIP + ":" + myPort + " - propagation " + propagationStats().summary();
+    }
+
+    // Send-queue delay per traffic class, merged over the I/O loops; safe to call from any
+    // thread other than an I/O loop.
+    QueueDelays queueDelays() {
+        QueueDelays merged;
+        for(auto &ioPtr : ioLoops) {
+            IoLoop *io = ioPtr.get();
+            promise<QueueDelays> result;
+            auto future = result.get_future();
+            io->loop->post([io, &result] { result.set_value(io->queueDelays); });
+            merged.merge(future.get());
+        }
+        return merged;
+    }
+
+    string queueDelaySummary() {
+        return "Peer " + myIP + ":" + myPort + " - queue delay " + queueDelays().summary();
+    }
+
+    // Send-queue depth, drops and write counts for every connection, gathered from each I/O loop;
+    // safe to call from any thread other than an I/O loop.
+    string outboundSummary() {
+        string out;
+        for(auto &ioPtr : ioLoops) {
+            IoLoop *io = ioPtr.get();
+            promise<string> result;
+            auto future = result.get_future();
+            io->loop->post([io, &result] {
+                ostringstream oss;
+                for(auto &entry : io->conns)
+                    oss << "outbound " << entry.second->addr << (entry.second->outbound ? "" : " (inbound)")
+                        << " " << entry.second->out.summary() << "\n";
+                result.set_value(oss.str());
+            });
+            out += future.get();
+        }
+        return out;
     }
 
     // Reports a dead neighbor using the format:
     // Dead Node:<DeadNode.IP>:<DeadNode.Port>:<self.timestamp>:<self.IP>
-    // Then notifies all seeds.
-    void reportDeadNeighbor(const string &nbr, int sock) {
+    // Then notifies all chosen seeds over their sessions (reports close together share a frame).
+    void reportDeadNeighbor(const string &nbr) {
         string timestamp = getCurrentTimestamp();
         string deadMsg = "Dead Node:" + nbr + ":" + timestamp + ":" + myIP;
-        cout << deadMsg << endl;
-        outputFile << deadMsg << endl;
-        for(auto &seed : chosenSeeds) {
-            int sfd = socket(AF_INET, SOCK_STREAM, 0);
-            if(sfd < 0) continue;
-            struct sockaddr_in servAddr;
-            memset(&servAddr, 0, sizeof(servAddr));
-            servAddr.sin_family = AF_INET;
-            servAddr.sin_port = htons(seed.second);
-            if(inet_pton(AF_INET, seed.first.c_str(), &servAddr.sin_addr) <= 0) {
-                close(sfd);
-                continue;
-            }
-            if(connect(sfd, (struct sockaddr *)&servAddr, sizeof(servAddr)) < 0) {
-                close(sfd);
-                continue;
-            }
-            size_t pos = nbr.find(":");
-            string nbrIP = nbr.substr(0, pos);
-            string nbrPort = nbr.substr(pos+1);
-            string report = "DEAD " + nbrIP + " " + nbrPort + " " + timestamp + " " + myIP;
-            send(sfd, report.c_str(), report.size(), 0);
-            close(sfd);
-        }
-        close(sock);
-        neighborSock.erase(nbr);
+        logLine(deadMsg);
+        for(auto &session : seedSessions)
+            session->reportDead(nbr);
+        auto table = neighborSock.read();
+        auto it = table->find(nbr);
+        if(it != table->end() && it->second.fd != -1) {
+            ConnRef r = it->second;
+            runOn(r.io, [this, r] {
+                if(PeerConn *c = findConn(r.io, r.fd, r.connId))
+                    closeConn(c);
+            });
+        }
+        neighborSock.update([&nbr](unordered_map<string, ConnRef> &m) { m.erase(nbr); });
         connectedNeighbors.erase(nbr);
-        pingFailures.erase(nbr);
+        heardFrom.erase(nbr);
+        liveness.removeNeighbor(nbr);
     }
 
     // ------------------------------
-    // Start Listener Thread
+    // Start Listener and Event Loop Thread
     // ------------------------------
     void startListener() {
-        thread t(&PeerNode::listenForPeerConnections, this);
-        t.detach();
+        listenForPeerConnections();
+        for(int i = 1; i < ioThreads; i++) {
+            extraLoops.push_back(make_unique<EventLoop>());
+            ioLoops.push_back(make_unique<IoLoop>());
+            ioLoops.back()->loop = extraLoops.back().get();
+            extraThreads.emplace_back(&EventLoop::run, extraLoops.back().get());
+        }
+        loopThread = thread(&EventLoop::run, &loop);
+        if(rumorConfig.mode == ForwardMode::Rumor) {
+            fanout = min(max(rumorConfig.fanout, rumorConfig.minFanout), rumorConfig.maxFanout);
+            for(auto &ioPtr : ioLoops) {
+                IoLoop *io = ioPtr.get();
+                io->loop->post([this, io] {
+                    io->loop->runEvery(rumorConfig.roundInterval, [this, io] { rumorRound(io); });
+                });
+            }
+            loop.post([this] { loop.runEvery(rumorConfig.adaptInterval, [this] { adaptFanout(); }); });
+        }
     }
+
+    // Gossip traffic against what flooding would have sent, and the rumor state.
+    string forwardSummary() {
+        auto &c = forwardCounters;
+        ostringstream oss;
+        oss << "Peer " << myIP << ":" << myPort << " - forward mode="
+            << (rumorConfig.mode == ForwardMode::Rumor ? "rumor" : "flood") << " fanout=" << fanout
+            << " received=" << c.received << " duplicates=" << c.duplicates << " forwards=" << c.forwards
+            << " frames_sent=" << c.framesSent << " flood_frames=" << c.floodFrames
+            << " bytes_sent=" << c.bytesSent << " flood_bytes=" << c.floodBytes
+            << " ttl_expired=" << c.ttlExpired << " killed_by_duplicates=" << c.killedByDuplicates
+            << " hot=" << rumors.size();
+        return oss.str();
+    }
+};
+
+// ------------------------------
+// Topology Files
+// ------------------------------
+// A peer of a topology file (topology_file.hpp) and how it joins: the seeds it is linked to
+// and all of its peer neighbors, which it dials. Gossip only goes out over dialed connections,
+// so both ends of every link dial each other; launchers start every listener before any peer
+// registers, so each finds its neighbors listening.
+struct TopologyPeer {
+    string ip, port;
+    vector<pair<string,int>> seeds;
+    vector<string> dials; // "IP:Port"
 };
+
+// Splits a topology whose node names are "IP:Port" into its seeds and its peers, in file order.
+// Returns false, with a message, if the file fails validation or a name is not an address.
+bool planTopology(const MappedTopology &topo, vector<pair<string,int>> &seeds, vector<TopologyPeer> &peers) {
+    if(!topo.validate()) {
+        cerr << "Topology file is corrupt" << endl;
+        return false;
+    }
+    vector<pair<string,int>> addrs(topo.node_count());
+    for(uint32_t id = 0; id < topo.node_count(); id++) {
+        string ip, port;
+        if(!splitHostPort(topo.name(id), ip, port) || atoi(port.c_str()) <= 0) {
+            cerr << "Topology node " << id << " (" << topo.name(id) << ") is not IP:Port" << endl;
+            return false;
+        }
+        addrs[id] = {ip, atoi(port.c_str())};
+        if(topo.type(id) == NodeType::SEED)
+            seeds.push_back(addrs[id]);
+    }
+    for(uint32_t id = 0; id < topo.node_count(); id++) {
+        if(topo.type(id) != NodeType::PEER)
+            continue;
+        TopologyPeer peer;
+        peer.ip = addrs[id].first;
+        peer.port = to_string(addrs[id].second);
+        for(uint32_t nbr : topo.neighbors(id)) {
+            if(topo.type(nbr) == NodeType::SEED)
+                peer.seeds.push_back(addrs[nbr]);
+            else
+                peer.dials.push_back(string(topo.name(nbr)));
+        }
+        peers.push_back(move(peer));
+    }
+    return true;
+}
@@ -1,40 +1,39 @@
 // network_builder.hpp
+/*
+  NetworkBuilder grows a power-law overlay one peer at a time. Nodes are dense integer ids
+  with interned names, and edges live in an AdjacencyStore (overlay_graph.hpp); freeze()
+  returns the topology in CSR form. A DegreeHistogram (power_law.hpp) follows every edge, so
+  the power-law check in add_peer() and the degree distribution cost O(1) and O(max degree)
+  instead of a pass over all nodes. New edges go to nodes picked in proportion to their degree
+  by an AttachmentSampler (attachment.hpp), either at the end of a short random walk from the
+  new peer or from the whole network (AttachmentMode), in O(1) per step. add_peers() builds
+  in bulk: each round, its peers pick their targets in parallel from the graph as it stood
+  when the round began, and the results are applied in order. The result depends only on
+  seed(), never on the thread count. A growing overlay takes about a third of the memory of
+  the earlier Node objects holding unordered_sets of shared_ptrs, and a frozen one a tenth or
+  less (./bench topology). write_topology() saves it in the mmap-able format of
+  topology_file.hpp.
+*/
 #pragma once
 #include <random>
 #include <vector>
 #include <unordered_map>
-#include <unordered_set>
-#include <queue>
-#include <memory>
+#include <string>
+#include <string_view>
+#include <numeric>
 #include <cmath>
 #include <algorithm>
+#include <chrono>
+#include <thread>
+#include "overlay_graph.hpp"
+#include "power_law.hpp"
+#include "attachment.hpp"
+#include "topology_file.hpp"
 
-class Node {
-public:
-    enum class Type { SEED, PEER };
-    
-    Node(const std::string& id, Type type) 
-        : id_(id), type_(type) {}
-    
-    void add_connection(std::shared_ptr<Node> node) {
-        connections_.insert(node);
-    }
-    
-    void remove_connection(std::shared_ptr<Node> node) {
-        connections_.erase(node);
-    }
-    
-    size_t degree() const { return connections_.size(); }
-    const std::string& id() const { return id_; }
-    Type type() const { return type_; }
-    const std::unordered_set<std::shared_ptr<Node>>& connections() const { 
-        return connections_; 
-    }
-
-private:
-    std::string id_;
-    Type type_;
-    std::unordered_set<std::shared_ptr<Node>> connections_;
+// How add_peer() picks the nodes a new peer attaches to, in proportion to their degree.
+enum class AttachmentMode : uint8_t {
+    RANDOM_WALK,  // among the nodes near the peer: the end of a degree-weighted walk
+    GLOBAL        // among all nodes (Barabasi-Albert)
 };
 
 class NetworkBuilder {
@@ -42,71 +41,212 @@ public:
     NetworkBuilder(double alpha = 2.5, size_t min_connections = 2, 
                   size_t max_connections = 10)
         : alpha_(alpha), min_connections_(min_connections), 
-          max_connections_(max_connections), random_engine_(random_device_()) {}
+          max_connections_(max_connections), random_engine_(random_device_()),
+          master_seed_(random_engine_()), degrees_(min_connections) {}
+    
+    // Makes the build reproducible: the same seed and the same calls give the same graph.
+    void seed(uint64_t seed) {
+        random_engine_.seed(seed);
+        master_seed_ = seed;
+    }
+    
+    // How far the estimated exponent may be from alpha and still pass
+    // follows_power_law_distribution(), at least (default 0.1).
+    void set_fit_tolerance(double tolerance) { fit_tolerance_ = tolerance; }
+    
+    void set_attachment_mode(AttachmentMode mode) { mode_ = mode; }
+    
+    // Counts only edges between peers toward min_connections and in the degree histogram (so
+    // the power-law fit describes the peer overlay), and stops walks from adding further seed
+    // edges. Seeds do not relay gossip, so a gossip overlay needs every peer to have peer
+    // neighbors; by default two seed edges are enough and many peers have none. Call before
+    // adding nodes.
+    void set_peer_links_only(bool on) { peer_links_only_ = on; }
     
     // Add seed nodes to the network
     void add_seed_nodes(const std::vector<std::string>& seed_ids) {
         for (const auto& id : seed_ids) {
-            auto seed = std::make_shared<Node>(id, Node::Type::SEED);
-            nodes_[id] = seed;
-            seed_nodes_.push_back(seed);
+            seed_nodes_.push_back(add_node(id, NodeType::SEED));
         }
     }
     
-    // Add a new peer to the network using random walks and preferential attachment
+    // Add a new peer to the network using random walks and preferential attachment.
+    // A name that is already in the network refers to the existing node.
     void add_peer(const std::string& peer_id) {
-        auto peer = std::make_shared<Node>(peer_id, Node::Type::PEER);
-        nodes_[peer_id] = peer;
+        uint32_t peer = add_node(peer_id, NodeType::PEER);
         
         // Connect to required number of seed nodes
         connect_to_seeds(peer);
+        attach(peer, nullptr, 0, random_engine_);
+    }
+    
+    // Adds peer_ids in order, as add_peer() would, but in rounds of about a sixteenth of the
+    // network. Each round's peers pick their seeds and candidate targets on up to `threads`
+    // threads (0: one per core), against the graph as it stood at the start of the round.
+    // Peer k of the builder's bulk peers draws from its own stream of seed(). The picks are
+    // then applied in order with add_peer()'s stopping rule, walking further only when a
+    // peer runs out of candidates. So the graph depends on the seed and the peers, not on
+    // `threads`.
+    void add_peers(const std::vector<std::string>& peer_ids, unsigned threads = 0) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        const size_t required_seeds = std::min(seed_nodes_.size() / 2 + 1, seed_nodes_.size());
+        const size_t width = required_seeds + proposed_walks; // targets proposed per peer
+        std::vector<uint32_t> proposals;
+        std::vector<SplitMix64> streams;
         
-        // Use random walks for further connections
-        while (peer->degree() < min_connections_ || 
-               !follows_power_law_distribution()) {
-            if (peer->degree() >= max_connections_) break;
+        for (size_t first = 0; first < peer_ids.size();) {
+            size_t round = std::min(peer_ids.size() - first,
+                                    std::max<size_t>(1, graph_.node_count() / 16));
+            proposals.resize(round * width);
+            streams.resize(round);
+            auto propose_range = [&](size_t begin, size_t end) {
+                for (size_t j = begin; j < end; ++j) {
+                    streams[j] = SplitMix64::stream(master_seed_, bulk_peers_ + j);
+                    propose(required_seeds, streams[j], &proposals[j * width]);
+                }
+            };
+            auto propose_start = std::chrono::steady_clock::now();
+            size_t workers = std::min<size_t>(threads, round / min_peers_per_thread);
+            if (workers <= 1) {
+                propose_range(0, round);
+            } else {
+                std::vector<std::thread> pool;
+                for (size_t w = 0; w < workers; ++w)
+                    pool.emplace_back(propose_range, round * w / workers, round * (w + 1) / workers);
+                for (auto& t : pool) t.join();
+            }
             
-            auto target = random_walk(peer);
-            if (target && target != peer && 
-                !are_connected(peer, target)) {
-                connect_nodes(peer, target);
+            auto apply_start = std::chrono::steady_clock::now();
+            for (size_t j = 0; j < round; ++j) {
+                uint32_t peer = add_node(peer_ids[first + j], NodeType::PEER);
+                const uint32_t* targets = &proposals[j * width];
+                for (size_t k = 0; k < required_seeds; ++k) {
+                    connect_nodes(peer, targets[k]);
+                }
+                attach(peer, targets + required_seeds, proposed_walks, streams[j]);
             }
+            sampler_.refresh(graph_);
+            auto round_end = std::chrono::steady_clock::now();
+            parallel_seconds_ += std::chrono::duration<double>(apply_start - propose_start).count();
+            sequential_seconds_ += std::chrono::duration<double>(round_end - apply_start).count();
+            first += round;
+            bulk_peers_ += round;
         }
     }
     
-    // Check if the network follows power-law distribution
+    // Seconds add_peers() has spent so far proposing (the part that runs on `threads` threads)
+    // and applying the picks and refreshing the sampler (the part that does not). Bounds how
+    // far more threads can take it.
+    double bulk_parallel_seconds() const { return parallel_seconds_; }
+    double bulk_sequential_seconds() const { return sequential_seconds_; }
+    
+    // Check if the network follows power-law distribution: the maximum-likelihood exponent
+    // of the degrees >= min_connections is within two standard errors (or the fit tolerance)
+    // of alpha. O(1).
     bool follows_power_law_distribution() const {
-        if (nodes_.size() < 10) return true; // Too few nodes to verify
+        if (graph_.node_count() < 10) return true; // Too few nodes to verify
         
-        std::vector<size_t> degrees;
-        for (const auto& pair : nodes_) {
-            degrees.push_back(pair.second->degree());
-        }
-        
-        return verify_power_law(degrees);
+        PowerLawFit fit = degrees_.fit();
+        if (fit.tail_nodes == 0) return false;
+        return std::abs(fit.alpha - alpha_) <= std::max(fit_tolerance_, 2 * fit.std_error);
     }
     
+    // Estimated exponent of the current degree distribution.
+    PowerLawFit power_law_fit() const { return degrees_.fit(); }
+    
+    // Kolmogorov-Smirnov distance between the degree tail and power_law_fit(): 0 is a perfect
+    // fit. Costs O(max degree), so it can be sampled while generating at scale.
+    double goodness_of_fit() const { return degrees_.ks_distance(); }
+    
+    const DegreeHistogram& degree_histogram() const { return degrees_; }
+    
     // Get current network statistics
     std::unordered_map<size_t, size_t> get_degree_distribution() const {
         std::unordered_map<size_t, size_t> distribution;
-        for (const auto& pair : nodes_) {
-            distribution[pair.second->degree()]++;
+        const std::vector<uint64_t>& counts = degrees_.counts();
+        for (size_t degree = 0; degree < counts.size(); ++degree) {
+            if (counts[degree] > 0) distribution[degree] = counts[degree];
         }
         return distribution;
     }
+    
+    size_t node_count() const { return graph_.node_count(); }
+    size_t edge_count() const { return graph_.edge_count(); }
+    std::string_view name(uint32_t id) const { return names_.name(id); }
+    NodeType type(uint32_t id) const { return types_[id]; }
+    uint32_t find(std::string_view name) const { return names_.find(name); }
+    const AdjacencyStore& graph() const { return graph_; }
+    
+    // The current topology in CSR form, ids as above.
+    CsrGraph freeze() const { return graph_.freeze(); }
+    
+    // Writes the current topology as a topology file (topology_file.hpp) that peer launchers
+    // can map. False, with a message on stderr, on failure.
+    bool write_topology(const std::string& path) const {
+        return ::write_topology(path, names_, types_, freeze());
+    }
+    
+    // Bytes held by names, node types, adjacency, the degree histogram and the sampler.
+    size_t memory_bytes() const {
+        return names_.memory_bytes() + types_.capacity() + graph_.memory_bytes() +
+               seed_nodes_.capacity() * sizeof(uint32_t) + degrees_.counts().capacity() * sizeof(uint64_t) +
+               links_.capacity() * sizeof(uint32_t) +
+               sampler_.memory_bytes();
+    }
 
 private:
+    static const size_t max_failed_walks = 64;  // in a row, before add_peer gives up
+    static const size_t max_walk_steps = 10;
+    static const size_t min_peers_per_thread = 256; // add_peers() runs smaller rounds inline
+    // Walks add_peers() runs ahead per peer. Most peers stop at their seeds plus at most one
+    // walk, so proposing more wastes time and fewer leaves it all to the sequential phase.
+    static const size_t proposed_walks = 1;
+    
     double alpha_;  // Power-law exponent
     size_t min_connections_;
     size_t max_connections_;
     std::random_device random_device_;
-    std::mt19937 random_engine_;
+    std::mt19937_64 random_engine_;
+    uint64_t master_seed_;         // add_peers() streams
+    uint64_t bulk_peers_ = 0;      // peers added by add_peers() so far
+    double parallel_seconds_ = 0;  // add_peers() phase times
+    double sequential_seconds_ = 0;
     
-    std::unordered_map<std::string, std::shared_ptr<Node>> nodes_;
-    std::vector<std::shared_ptr<Node>> seed_nodes_;
+    NameTable names_;              // node id <-> name
+    std::vector<NodeType> types_;  // by node id
+    AdjacencyStore graph_;
+    std::vector<uint32_t> seed_nodes_;
+    DegreeHistogram degrees_;      // tail starts at min_connections
+    std::vector<uint32_t> links_;  // by node id: its degree as degrees_ counts it
+    double fit_tolerance_ = 0.1;
+    bool peer_links_only_ = false;
+    AttachmentSampler sampler_;
+    AttachmentMode mode_ = AttachmentMode::RANDOM_WALK;
+    
+    uint32_t add_node(const std::string& name, NodeType type) {
+        uint32_t id = names_.intern(name);
+        if (id == graph_.node_count()) {
+            graph_.add_node(type == NodeType::PEER ? static_cast<uint32_t>(min_connections_) : 0);
+            types_.push_back(type);
+            degrees_.add_node();
+            links_.push_back(0);
+        }
+        return id;
+    }
+    
+    // Connect two nodes; false if they are the same or already connected
+    bool connect_nodes(uint32_t a, uint32_t b) {
+        if (!graph_.add_edge(a, b)) return false;
+        sampler_.add_edge(a, b);
+        if (!peer_links_only_ || (types_[a] == NodeType::PEER && types_[b] == NodeType::PEER)) {
+            degrees_.increment(links_[a]++);
+            degrees_.increment(links_[b]++);
+        }
+        return true;
+    }
     
     // Connect a peer to required number of seed nodes
-    void connect_to_seeds(std::shared_ptr<Node> peer) {
+    void connect_to_seeds(uint32_t peer) {
         size_t required_seeds = (seed_nodes_.size() / 2) + 1;
         std::vector<size_t> indices(seed_nodes_.size());
         std::iota(indices.begin(), indices.end(), 0);
@@ -117,79 +257,80 @@ private:
         }
     }
     
-    // Perform a random walk in the network
-    std::shared_ptr<Node> random_walk(std::shared_ptr<Node> start) {
-        const size_t max_steps = 10;
-        std::shared_ptr<Node> current = start;
-        
-        for (size_t step = 0; step < max_steps; ++step) {
-            // Choose next node with probability proportional to degree
-            std::vector<std::shared_ptr<Node>> neighbors(
-                current->connections().begin(), 
-                current->connections().end());
+    // Use random walks (or global picks) for further connections until the peer has
+    // min_connections and the network follows the power law, trying the given candidates
+    // first. Extra edges only flatten the tail, so a fit already below alpha stops here
+    // rather than running every later peer up to max_connections. Walks that keep ending
+    // at the peer or at its neighbors (a small network has no one else) give up after a
+    // while.
+    template <class Rng>
+    void attach(uint32_t peer, const uint32_t* candidates, size_t count, Rng& rng) {
+        size_t failed_walks = 0;
+        while (links_[peer] < min_connections_ || 
+               (!follows_power_law_distribution() && degrees_.fit().alpha > alpha_)) {
+            if (graph_.degree(peer) >= max_connections_) break;
+            if (failed_walks >= max_failed_walks) break;
             
-            if (neighbors.empty()) break;
-            
-            std::vector<double> probabilities;
-            double sum_degrees = 0;
-            for (const auto& neighbor : neighbors) {
-                sum_degrees += neighbor->degree();
+            uint32_t target;
+            if (count > 0) {
+                target = *candidates++;
+                count--;
+            } else {
+                target = mode_ == AttachmentMode::GLOBAL
+                    ? sampler_.sample_global(rng) : random_walk(sampler_, peer, rng);
             }
-            
-            for (const auto& neighbor : neighbors) {
-                probabilities.push_back(
-                    static_cast<double>(neighbor->degree()) / sum_degrees);
+            bool usable = target != NO_NODE && target != peer &&
+                          !(peer_links_only_ && types_[target] == NodeType::SEED);
+            if (usable && connect_nodes(peer, target)) {
+                failed_walks = 0;
+            } else {
+                failed_walks++;
             }
-            
-            std::discrete_distribution<> dist(
-                probabilities.begin(), probabilities.end());
-            current = neighbors[dist(random_engine_)];
         }
-        
-        return current;
-    }
-    
-    // Connect two nodes
-    void connect_nodes(std::shared_ptr<Node> a, std::shared_ptr<Node> b) {
-        if (a && b && a != b) {
-            a->add_connection(b);
-            b->add_connection(a);
-        }
-    }
-    
-    // Check if two nodes are connected
-    bool are_connected(std::shared_ptr<Node> a, std::shared_ptr<Node> b) const {
-        return a->connections().find(b) != a->connections().end();
     }
     
-    // Verify power-law distribution using Kolmogorov-Smirnov test
-    bool verify_power_law(const std::vector<size_t>& degrees) const {
-        if (degrees.empty()) return false;
-        
-        // Calculate empirical distribution
-        std::vector<double> empirical;
-        for (size_t degree : degrees) {
-            empirical.push_back(
-                static_cast<double>(degree) / degrees.size());
+    // Fills out[0, required_seeds) with distinct seeds and the next proposed_walks slots
+    // with walk targets for a peer that is not in the graph yet, as if it were linked to
+    // those seeds. Only reads the builder, so several threads may propose at once.
+    void propose(size_t required_seeds, SplitMix64& rng, uint32_t* out) const {
+        for (size_t k = 0; k < required_seeds; ++k) {
+            uint32_t seed;
+            do {
+                seed = seed_nodes_[std::uniform_int_distribution<size_t>(0, seed_nodes_.size() - 1)(rng)];
+            } while (std::find(out, out + k, seed) != out + k);
+            out[k] = seed;
         }
-        std::sort(empirical.begin(), empirical.end());
         
-        // Calculate theoretical distribution
-        std::vector<double> theoretical;
-        for (size_t i = 0; i < degrees.size(); ++i) {
-            double x = static_cast<double>(i + 1) / degrees.size();
-            theoretical.push_back(std::pow(x, -1.0 / alpha_));
+        uint64_t seed_degrees = 0;
+        for (size_t k = 0; k < required_seeds; ++k) seed_degrees += graph_.degree(out[k]) + 1;
+        for (size_t k = 0; k < proposed_walks; ++k) {
+            uint32_t target = NO_NODE;
+            if (mode_ == AttachmentMode::GLOBAL) {
+                target = sampler_.sample_global(rng);
+            } else if (required_seeds > 0) {
+                // First step onto one of the peer's seeds, by degree, then walk on.
+                uint64_t pick = std::uniform_int_distribution<uint64_t>(0, seed_degrees - 1)(rng);
+                size_t s = 0;
+                while (pick >= graph_.degree(out[s]) + 1) pick -= graph_.degree(out[s++]) + 1;
+                target = random_walk(sampler_, out[s], rng, max_walk_steps - 1);
+            }
+            out[required_seeds + k] = target;
         }
+    }
+    
+    // Perform a random walk in the network. With a const sampler it only reads.
+    template <class Sampler, class Rng>
+    uint32_t random_walk(Sampler& sampler, uint32_t start, Rng& rng,
+                         size_t max_steps = max_walk_steps) const {
+        uint32_t current = start;
         
-        // Calculate KS statistic
-        double max_diff = 0.0;
-        for (size_t i = 0; i < degrees.size(); ++i) {
-            max_diff = std::max(max_diff, 
-                std::abs(empirical[i] - theoretical[i]));
+        for (size_t step = 0; step < max_steps; ++step) {
+            // Choose next node with probability proportional to degree
+            uint32_t next = sampler.sample_neighbor(graph_, current, rng);
+            if (next == NO_NODE) break;
+            current = next;
         }
         
-        // Critical value for 95% confidence
-        double critical_value = 1.36 / std::sqrt(degrees.size());
-        return max_diff <= critical_value;
+        return current;
     }
 };
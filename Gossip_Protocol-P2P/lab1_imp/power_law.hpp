@@ -0,0 +1,101 @@
+// power_law.hpp
+/*
+  Degree statistics for NetworkBuilder (pl.hpp), kept up to date edge by edge.
+
+    • DegreeHistogram counts nodes per degree. add_node() and increment() are O(1), so the
+      builder updates it on every new edge instead of collecting every node's degree.
+    • With the histogram it keeps the sufficient statistic of the maximum-likelihood estimate
+      of the power-law exponent over the tail (degrees >= x_min), in the discrete
+      approximation of Clauset, Shalizi and Newman (2009):
+          alpha = 1 + n_tail / sum(ln(d_i / (x_min - 1/2)))
+      so fit() is O(1) as well.
+    • ks_distance() is the goodness of fit: the largest gap between the tail's empirical
+      complementary CDF and the fitted ((d - 1/2) / (x_min - 1/2))^(1 - alpha). It walks the
+      histogram, so it costs O(max degree) rather than a sort of every node.
+
+  Not thread-safe.
+*/
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+struct PowerLawFit {
+    double alpha = 0;       // estimated exponent; 0 while the tail is empty
+    double std_error = 0;   // (alpha - 1) / sqrt(tail_nodes)
+    size_t x_min = 1;
+    size_t tail_nodes = 0;  // nodes with degree >= x_min
+};
+
+class DegreeHistogram {
+public:
+    explicit DegreeHistogram(size_t x_min = 1) : x_min_(std::max<size_t>(x_min, 1)) {}
+
+    void add_node(size_t degree = 0) {
+        slot(degree)++;
+        nodes_++;
+        if (degree >= x_min_) {
+            tail_nodes_++;
+            log_sum_ += std::log(degree / (x_min_ - 0.5));
+        }
+    }
+
+    // A node's degree went from degree to degree + 1.
+    void increment(size_t degree) {
+        counts_[degree]--;
+        slot(degree + 1)++;
+        if (degree >= x_min_) {
+            log_sum_ += std::log((degree + 1.0) / degree);
+        } else if (degree + 1 == x_min_) {
+            tail_nodes_++;
+            log_sum_ += std::log(x_min_ / (x_min_ - 0.5));
+        }
+    }
+
+    size_t nodes() const { return nodes_; }
+    size_t x_min() const { return x_min_; }
+    size_t max_degree() const { return counts_.empty() ? 0 : counts_.size() - 1; }
+    // Nodes per degree, indexed by degree; may end in zeros.
+    const std::vector<uint64_t>& counts() const { return counts_; }
+
+    PowerLawFit fit() const {
+        PowerLawFit f;
+        f.x_min = x_min_;
+        f.tail_nodes = tail_nodes_;
+        if (tail_nodes_ > 0 && log_sum_ > 0) {
+            f.alpha = 1.0 + tail_nodes_ / log_sum_;
+            f.std_error = (f.alpha - 1.0) / std::sqrt(static_cast<double>(tail_nodes_));
+        }
+        return f;
+    }
+
+    // Kolmogorov-Smirnov distance between the tail and fit(); 1 when there is no fit.
+    double ks_distance() const {
+        PowerLawFit f = fit();
+        if (f.alpha <= 1.0)
+            return 1.0;
+        double max_diff = 0.0;
+        uint64_t at_least = 0; // tail nodes with degree >= d
+        for (size_t d = max_degree(); d >= x_min_ && d > 0; --d) {
+            at_least += counts_[d];
+            double empirical = static_cast<double>(at_least) / tail_nodes_;
+            double theoretical = std::pow((d - 0.5) / (x_min_ - 0.5), 1.0 - f.alpha);
+            max_diff = std::max(max_diff, std::abs(empirical - theoretical));
+        }
+        return max_diff;
+    }
+
+private:
+    size_t x_min_;
+    std::vector<uint64_t> counts_;  // nodes by degree
+    size_t nodes_ = 0;
+    size_t tail_nodes_ = 0;
+    double log_sum_ = 0;            // sum over the tail of ln(degree / (x_min - 1/2))
+
+    uint64_t& slot(size_t degree) {
+        if (degree >= counts_.size())
+            counts_.resize(degree + 1);
+        return counts_[degree];
+    }
+};
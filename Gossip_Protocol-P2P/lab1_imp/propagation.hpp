@@ -0,0 +1,85 @@
+// propagation.hpp
+/*
+  PropagationStats: what a peer has observed about gossip reaching it.
+
+  Each new gossip message is recorded once, at first receipt, with its end-to-end latency
+  (receive time minus the origin's monotonic timestamp) and the hop count carried in its frame
+  header. Besides the overall latency and hop histograms, compact per-origin totals are kept so
+  summary() can name the origins whose messages arrive slowest, i.e. the slow paths into this
+  peer.
+
+  Not thread-safe; each I/O loop keeps its own instance and merge() combines them.
+*/
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "frame_pool.hpp"
+#include "histogram.hpp"
+#include "wire.hpp"
+
+struct OriginStats {
+    uint64_t count = 0;
+    uint64_t latencySumNs = 0;
+    uint64_t maxLatencyNs = 0;
+    uint64_t hopsSum = 0;
+};
+
+class PropagationStats {
+public:
+    void record(uint64_t originId, uint64_t latencyNs, unsigned hops) {
+        latencyNs_.record(latencyNs);
+        hops_.record(hops);
+        OriginStats &o = origins_[originId];
+        o.count++;
+        o.latencySumNs += latencyNs;
+        o.maxLatencyNs = std::max(o.maxLatencyNs, latencyNs);
+        o.hopsSum += hops;
+    }
+
+    void merge(const PropagationStats &other) {
+        latencyNs_.merge(other.latencyNs_);
+        hops_.merge(other.hops_);
+        for (auto &entry : other.origins_) {
+            OriginStats &o = origins_[entry.first];
+            o.count += entry.second.count;
+            o.latencySumNs += entry.second.latencySumNs;
+            o.maxLatencyNs = std::max(o.maxLatencyNs, entry.second.maxLatencyNs);
+            o.hopsSum += entry.second.hopsSum;
+        }
+    }
+
+    const LatencyHistogram &latencyNs() const { return latencyNs_; }
+    const LatencyHistogram &hops() const { return hops_; }
+    size_t origins() const { return origins_.size(); }
+
+    // "latency_us[...] hops[...] origins=<n>" and one line per slowest origin (by mean latency).
+    std::string summary(size_t slowest = 5) const {
+        std::ostringstream oss;
+        oss << "latency_us[" << latencyNs_.summary(1e3) << "] hops[" << hops_.summary() << "] origins="
+            << origins_.size();
+        std::vector<std::pair<double, uint64_t>> byMean;
+        for (auto &entry : origins_)
+            byMean.push_back({(double)entry.second.latencySumNs / entry.second.count, entry.first});
+        size_t n = std::min(slowest, byMean.size());
+        std::partial_sort(byMean.begin(), byMean.begin() + n, byMean.end(),
+                          [](const auto &a, const auto &b) { return a.first > b.first; });
+        for (size_t i = 0; i < n; i++) {
+            const OriginStats &o = origins_.at(byMean[i].second);
+            oss << "\n  slow origin " << originIdToString(byMean[i].second) << " msgs=" << o.count
+                << " mean_us=" << byMean[i].first / 1e3 << " max_us=" << o.maxLatencyNs / 1e3
+                << " mean_hops=" << (double)o.hopsSum / o.count;
+        }
+        return oss.str();
+    }
+
+private:
+    LatencyHistogram latencyNs_;
+    LatencyHistogram hops_;
+    // Nodes come from the SlabPool, so the first message from each origin does not allocate.
+    std::unordered_map<uint64_t, OriginStats, std::hash<uint64_t>, std::equal_to<uint64_t>,
+                       SlabAllocator<std::pair<const uint64_t, OriginStats>>> origins_;
+};
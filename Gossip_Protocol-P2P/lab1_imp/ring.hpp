@@ -0,0 +1,63 @@
+// ring.hpp
+/*
+  HashRing: consistent-hash ring over the seed servers ("IP:Port").
+
+  Each seed is placed at vnodes pseudo-random points on a 64-bit ring. A key (a peer's
+  "IP:Port") is owned by the first `replicas` distinct seeds found walking clockwise from the
+  key's hash. Every seed built from the same seed list computes the same owners, so seeds need
+  no coordination to agree on who stores what, and adding a seed moves only about 1/n of the
+  keys.
+
+  Immutable after construction; safe to share between threads.
+*/
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "dedup.hpp"
+
+class HashRing {
+public:
+    HashRing() = default;
+
+    HashRing(const std::vector<std::string> &nodes, int replicas, int vnodes = 64)
+        : nodes_(nodes), replicas_(std::max(1, std::min<int>(replicas, (int)nodes.size()))) {
+        for (size_t n = 0; n < nodes_.size(); n++)
+            for (int v = 0; v < vnodes; v++)
+                points_.push_back({splitmix64(hashMessage(nodes_[n]) + (uint64_t)v), n});
+        std::sort(points_.begin(), points_.end());
+    }
+
+    bool empty() const { return nodes_.empty(); }
+    int replicas() const { return replicas_; }
+    const std::vector<std::string> &nodes() const { return nodes_; }
+
+    // Indexes into nodes() of the seeds owning key, primary first.
+    std::vector<size_t> owners(std::string_view key) const {
+        std::vector<size_t> result;
+        if (points_.empty())
+            return result;
+        uint64_t h = splitmix64(hashMessage(key));
+        auto it = std::lower_bound(points_.begin(), points_.end(), std::make_pair(h, (size_t)0));
+        for (size_t i = 0; i < points_.size() && result.size() < (size_t)replicas_; i++, ++it) {
+            if (it == points_.end())
+                it = points_.begin();
+            if (std::find(result.begin(), result.end(), it->second) == result.end())
+                result.push_back(it->second);
+        }
+        return result;
+    }
+
+    bool owns(size_t node, std::string_view key) const {
+        auto o = owners(key);
+        return std::find(o.begin(), o.end(), node) != o.end();
+    }
+
+private:
+    std::vector<std::string> nodes_;
+    int replicas_ = 1;
+    std::vector<std::pair<uint64_t, size_t>> points_; // (ring position, node index)
+};
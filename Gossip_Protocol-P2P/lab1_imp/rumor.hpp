@@ -0,0 +1,119 @@
+// rumor.hpp
+/*
+  Rumor mongering: an alternative to flooding every new gossip message to every neighbor.
+
+  In ForwardMode::Rumor a peer that receives a new message pushes it to `fanout` random
+  neighbors at once and keeps it "hot": every roundInterval it pushes it to `fanout` more of
+  the remaining neighbors. A rumor dies when
+    • the peer has heard it stopAfterDuplicates more times (its neighborhood already has it),
+    • every neighbor has been sent it, or
+    • it arrived after ttl hops (it is delivered but not forwarded).
+  Messages the push phase misses are picked up by anti-entropy (anti_entropy.hpp).
+
+  The fanout adapts every adaptInterval: if more than targetDuplicateRate of the gossip frames
+  received were duplicates it shrinks by one, if fewer than half of that it grows by one,
+  within [minFanout, maxFanout].
+
+  RumorTable holds the hot rumors. It is sharded by message id and thread-safe, because a
+  duplicate may arrive on any I/O loop while the rumor is pushed from the loop that first
+  received it. Its nodes and target lists come from the SlabPool, so making a rumor hot does
+  not allocate.
+*/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "frame_pool.hpp"
+
+enum class ForwardMode { Flood, Rumor };
+
+struct RumorConfig {
+    ForwardMode mode = ForwardMode::Flood;
+    int fanout = 2;                                 // initial neighbors per push round
+    int minFanout = 1;
+    int maxFanout = 8;
+    int ttl = 16;                                   // hops after which a message is not forwarded
+    int stopAfterDuplicates = 2;                    // k: duplicates that kill a hot rumor
+    std::chrono::milliseconds roundInterval{20};
+    std::chrono::milliseconds adaptInterval{1000};
+    double targetDuplicateRate = 0.5;               // duplicates / gossip frames received
+};
+
+template <typename Target>
+class RumorTable {
+public:
+    using Frame = std::shared_ptr<const std::string>;
+    using Targets = std::vector<Target, SlabAllocator<Target>>;
+
+    explicit RumorTable(int shards = 16) {
+        for (int i = 0; i < std::max(shards, 1); i++)
+            shards_.push_back(std::make_unique<Shard>());
+    }
+
+    // Makes a rumor hot with the neighbors it has not been sent to yet (in push order).
+    void add(uint64_t id, Frame frame, Targets remaining) {
+        Shard &s = shard(id);
+        std::lock_guard<std::mutex> lock(s.mtx);
+        s.rumors[id] = Rumor{std::move(frame), std::move(remaining), 0, 0};
+    }
+
+    // Counts a duplicate receipt. Returns true if it killed a hot rumor.
+    bool duplicate(uint64_t id, int stopAfter) {
+        Shard &s = shard(id);
+        std::lock_guard<std::mutex> lock(s.mtx);
+        auto it = s.rumors.find(id);
+        if (it == s.rumors.end() || ++it->second.duplicates < stopAfter)
+            return false;
+        s.rumors.erase(it);
+        return true;
+    }
+
+    // Moves up to n next targets of a hot rumor into out and sets frame. Returns false once the
+    // rumor is gone (killed, or no targets were left); the caller then forgets the id.
+    bool take(uint64_t id, size_t n, std::vector<Target> &out, Frame &frame) {
+        Shard &s = shard(id);
+        std::lock_guard<std::mutex> lock(s.mtx);
+        auto it = s.rumors.find(id);
+        if (it == s.rumors.end())
+            return false;
+        Rumor &r = it->second;
+        size_t end = std::min(r.remaining.size(), r.next + n);
+        out.assign(r.remaining.begin() + r.next, r.remaining.begin() + end);
+        r.next = end;
+        frame = r.frame;
+        if (r.next == r.remaining.size())
+            s.rumors.erase(it);
+        return !out.empty();
+    }
+
+    size_t size() {
+        size_t n = 0;
+        for (auto &s : shards_) {
+            std::lock_guard<std::mutex> lock(s->mtx);
+            n += s->rumors.size();
+        }
+        return n;
+    }
+
+private:
+    struct Rumor {
+        Frame frame;
+        Targets remaining;
+        size_t next;
+        int duplicates;
+    };
+    struct alignas(64) Shard {
+        std::mutex mtx;
+        std::unordered_map<uint64_t, Rumor, std::hash<uint64_t>, std::equal_to<uint64_t>,
+                           SlabAllocator<std::pair<const uint64_t, Rumor>>> rumors;
+    };
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    Shard &shard(uint64_t id) { return *shards_[id % shards_.size()]; }
+};
@@ -1,32 +1,84 @@
 // seed.cpp
 #include <arpa/inet.h>
 #include <sys/socket.h>
+#include <sys/resource.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <thread>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
 #include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <cstring>
 #include <cstdlib>
+#include "event_loop.hpp"
+#include "wire.hpp"
+#include "logger.hpp"
+#include "membership.hpp"
+#include "ring.hpp"
+#include "seed_session.hpp"
+#include "seed_journal.hpp"
 using namespace std;
 
+// Connection handling model used by SeedServer::run().
+//   Threaded: one detached thread per accepted socket, blocking read() (original model).
+//   Reactor:  a fixed pool of epoll loops with nonblocking, edge-triggered sockets.
+enum class SeedMode { Threaded, Reactor };
+
 class SeedServer {
 public:
     string seedID; // e.g., "127.0.0.1:6000"
     int port;
     int server_fd;
-    unordered_map<string, string> peerList; // Maps peer "IP:Port" -> "Alive"
-    mutex mtx;
-    ofstream outputFile;
+    MembershipTable members; // Registered peers "IP:Port", versioned for delta GET_PEERS
+    SeedMode mode;
+    int reactorThreads; // Number of event loops in Reactor mode.
+    // Connection statistics (both modes) for comparing connections/sec and memory per connection.
+    atomic<long> connectionsAccepted{0};
+    atomic<long> connectionsActive{0};
+    chrono::steady_clock::time_point startTime;
+    long idleRssKb = 0; // process RSS when the listener came up, before any connection
 
-    SeedServer(const string &id, int port) : seedID(id), port(port) {
-        outputFile.open("outputfile.txt", ios::app);
-        if (!outputFile.is_open()) {
-            cerr << "Error opening outputfile.txt" << endl;
-        }
+    // Sharded membership (enableSharding()): the seeds form a consistent-hash ring, each peer
+    // entry lives on `replicas` owner seeds, and owners pull each other's membership deltas.
+    HashRing ring;                       // empty: every seed stores every peer (default)
+    size_t selfIndex = 0;                // this seed in ring.nodes()
+    unordered_set<uint64_t> seedOrigins; // frames from seeds are never forwarded again
+    chrono::milliseconds syncInterval{1000};
+    chrono::seconds tombstoneTtl{60};
+    EventLoop clusterLoop;
+    thread clusterThread;
+    // Cluster loop only: session to ring.nodes()[i] (null for this seed), the table epoch and
+    // last delta version pulled from it, whether a pull is outstanding, and the peers stored
+    // here only because its deltas listed them (what a full listing from it replaces).
+    vector<unique_ptr<SeedSession>> clusterSessions;
+    vector<uint64_t> syncedEpoch;
+    vector<uint64_t> syncedVersion;
+    vector<bool> pulling;
+    vector<unordered_set<string>> learnedFrom;
+    // Recently removed peers; replicated adds for them are ignored so that a removal is not
+    // undone by a stale delta from another owner.
+    mutex tombstoneMtx;
+    unordered_map<string, chrono::steady_clock::time_point> tombstones;
+    atomic<uint64_t> forwardedRegisters{0};
+    atomic<uint64_t> forwardedDeads{0};
+    atomic<uint64_t> deltaPulls{0};
+    atomic<uint64_t> replicatedChanges{0};
+
+    // Durable membership (enableJournal()): every change also goes to a write-ahead log.
+    unique_ptr<SeedJournal> journal;
+
+    SeedServer(const string &id, int port, SeedMode mode = SeedMode::Threaded, int reactorThreads = 0)
+      : seedID(id), port(port), mode(mode), reactorThreads(reactorThreads) {
+        if (this->reactorThreads <= 0)
+            this->reactorThreads = max(1u, thread::hardware_concurrency());
         // Create socket in seed.cpp
 server_fd = socket(AF_INET, SOCK_STREAM, 0);
 if (server_fd == 0) {
@@ -48,73 +100,296 @@ if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
             perror("Bind failed");
             exit(EXIT_FAILURE);
         }
-        if (listen(server_fd, 10) < 0) {
+        if (listen(server_fd, SOMAXCONN) < 0) {
             perror("Listen");
             exit(EXIT_FAILURE);
         }
-        cout << "SeedServer " << seedID << " listening on port " << port << endl;
-        outputFile << "SeedServer " << seedID << " listening on port " << port << endl;
+        logLine("SeedServer " + seedID + " listening on port " + to_string(port));
+        startTime = chrono::steady_clock::now();
+        idleRssKb = processRssKb();
+    }
+
+    ~SeedServer() {
+        if (clusterThread.joinable()) {
+            clusterLoop.stop();
+            clusterThread.join();
+        }
+    }
+
+    // Switches to sharded membership over the given seeds (this one included). Call before run().
+    void enableSharding(const vector<pair<string,int>> &seeds, int replicas) {
+        vector<string> nodes;
+        for (auto &s : seeds) {
+            nodes.push_back(s.first + ":" + to_string(s.second));
+            seedOrigins.insert(makeOriginId(s.first, s.second));
+        }
+        ring = HashRing(nodes, replicas);
+        selfIndex = find(nodes.begin(), nodes.end(), seedID) - nodes.begin();
+        syncedEpoch.assign(nodes.size(), 0);
+        syncedVersion.assign(nodes.size(), 0);
+        pulling.assign(nodes.size(), false);
+        learnedFrom.assign(nodes.size(), {});
+        uint64_t selfOrigin = makeOriginId(seedID.substr(0, seedID.rfind(':')), port);
+        clusterThread = thread(&EventLoop::run, &clusterLoop);
+        clusterLoop.post([this, seeds, selfOrigin] {
+            for (size_t i = 0; i < seeds.size(); i++)
+                clusterSessions.push_back(i == selfIndex ? nullptr
+                    : make_unique<SeedSession>(clusterLoop, seeds[i].first, seeds[i].second, selfOrigin));
+            clusterLoop.runEvery(syncInterval, [this] { pullDeltas(); });
+        });
+        logLine("Seed " + seedID + " - sharded membership: " + to_string(nodes.size()) + " seeds, " +
+                to_string(ring.replicas()) + " replicas per peer");
+    }
+
+    // Restores the membership saved by a previous run from dir and logs every change from now
+    // on. Call before run() (and before enableSharding()).
+    void enableJournal(const JournalConfig &cfg) {
+        journal = make_unique<SeedJournal>(cfg, port);
+        RecoveryStats stats;
+        if (!journal->recover(members, stats)) {
+            journal.reset();
+            return;
+        }
+        ostringstream oss;
+        oss << "Seed " << seedID << " - recovered " << stats.members << " peers (snapshot " << stats.snapshotEntries
+            << ", log records " << stats.logRecords << (stats.tornTail ? ", torn tail cut" : "")
+            << (stats.versionsKept ? ", versions kept" : ", new epoch") << ") in "
+            << stats.millis << " ms";
+        logLine(oss.str());
+    }
+
+    bool storeAdd(const string &key) {
+        return journal ? journal->add(members, key) : members.add(key);
+    }
+
+    bool storeRemove(const string &key) {
+        return journal ? journal->remove(members, key) : members.remove(key);
+    }
+
+    bool ownsPeer(const string &key) {
+        return ring.empty() || ring.owns(selfIndex, key);
+    }
+
+    // Hands a peer's REGISTER or DEAD for key to the key's other owners. Frames that came from
+    // a seed were already handed on by it.
+    void forwardToOwners(const FrameHeader &h, const string &key, bool dead) {
+        if (ring.empty() || seedOrigins.count(h.originId))
+            return;
+        for (size_t owner : ring.owners(key)) {
+            if (owner == selfIndex)
+                continue;
+            (dead ? forwardedDeads : forwardedRegisters)++;
+            clusterLoop.post([this, owner, key, dead] {
+                if (dead)
+                    clusterSessions[owner]->reportDead(key);
+                else
+                    clusterSessions[owner]->forwardRegister(key);
+            });
+        }
+    }
+
+    // Cluster loop: asks every other seed for its changes since the last pull and applies those
+    // for peers this seed owns. A full listing (first pull, the other seed restarted, or its log
+    // no longer reaches back) replaces what was learned from that seed: peers it no longer
+    // lists are removed, as if their removal had arrived as a delta.
+    void pullDeltas() {
+        expireTombstones();
+        for (size_t i = 0; i < clusterSessions.size(); i++) {
+            if (!clusterSessions[i] || pulling[i])
+                continue;
+            pulling[i] = true;
+            deltaPulls++;
+            clusterSessions[i]->getPeerDelta(syncedVersion[i], syncedEpoch[i], [this, i](const PeerDelta &delta) {
+                pulling[i] = false;
+                syncedEpoch[i] = delta.epoch;
+                syncedVersion[i] = delta.version;
+                unordered_set<string> &learned = learnedFrom[i];
+                vector<string> removed = delta.removed;
+                if (delta.full) {
+                    unordered_set<string> listed(delta.added.begin(), delta.added.end());
+                    for (auto it = learned.begin(); it != learned.end();) {
+                        if (listed.count(*it)) {
+                            ++it;
+                            continue;
+                        }
+                        removed.push_back(*it);
+                        it = learned.erase(it);
+                    }
+                }
+                for (auto &addr : delta.added)
+                    if (ownsPeer(addr) && !tombstoned(addr) && storeAdd(addr)) {
+                        replicatedChanges++;
+                        learned.insert(addr);
+                    }
+                for (auto &addr : removed) {
+                    learned.erase(addr);
+                    if (ownsPeer(addr) && storeRemove(addr)) {
+                        replicatedChanges++;
+                        tombstone(addr);
+                    }
+                }
+            });
+        }
+    }
+
+    void tombstone(const string &key) {
+        lock_guard<mutex> lock(tombstoneMtx);
+        tombstones[key] = chrono::steady_clock::now();
+    }
+
+    bool tombstoned(const string &key) {
+        lock_guard<mutex> lock(tombstoneMtx);
+        return tombstones.count(key) != 0;
+    }
+
+    void expireTombstones() {
+        lock_guard<mutex> lock(tombstoneMtx);
+        auto now = chrono::steady_clock::now();
+        for (auto it = tombstones.begin(); it != tombstones.end();)
+            it = now - it->second > tombstoneTtl ? tombstones.erase(it) : next(it);
+    }
+
+    // "Seed <id> - ring seeds=<n> replicas=<r> owned=<n> forwarded_registers=<n> ..."
+    string clusterSummary() {
+        ostringstream oss;
+        oss << "Seed " << seedID << " - ring seeds=" << ring.nodes().size() << " replicas=" << ring.replicas()
+            << " owned=" << members.size() << " forwarded_registers=" << forwardedRegisters
+            << " forwarded_deads=" << forwardedDeads << " delta_pulls=" << deltaPulls
+            << " replicated_changes=" << replicatedChanges;
+        return oss.str();
     }
 
     void addPeer(const string &ip, const string &peerPort) {
-        lock_guard<mutex> lock(mtx);
         string key = ip + ":" + peerPort;
-        peerList[key] = "Alive";
+        storeAdd(key);
         string logMsg = "Seed " + seedID + " - Peer registered: " + key;
-        cout << logMsg << endl;
-        outputFile << logMsg << endl;
+        logLine(logMsg);
     }
 
     void removePeer(const string &ip, const string &peerPort) {
-        lock_guard<mutex> lock(mtx);
         string key = ip + ":" + peerPort;
-        if (peerList.erase(key)) {
+        if (storeRemove(key)) {
             string logMsg = "Seed " + seedID + " - Dead peer removed: " + key;
-            cout << logMsg << endl;
-            outputFile << logMsg << endl;
+            logLine(logMsg);
         }
     }
 
-    // Returns a comma-delimited list of current peers.
+    // Returns a comma-delimited list of current peers (the cached snapshot).
     string getPeerList() {
-        lock_guard<mutex> lock(mtx);
+        return members.snapshot()->list;
+    }
+
+    // Handles one request frame, appending any reply frame to out.
+    // In sharded mode only the peers this seed owns are stored; REGISTER and DEAD from a peer
+    // are also handed to the other owners.
+    void processFrame(const FrameHeader &h, string_view payload, string &out) {
+        string ip, port;
+        switch (h.type) {
+        case MsgType::Register:
+            if (splitHostPort(payload, ip, port)) {
+                string key = ip + ":" + port;
+                if (ownsPeer(key)) {
+                    if (!ring.empty()) {
+                        lock_guard<mutex> lock(tombstoneMtx);
+                        tombstones.erase(key); // a real re-registration
+                    }
+                    addPeer(ip, port);
+                }
+                forwardToOwners(h, key, false);
+            }
+            break;
+        case MsgType::GetPeers:
+            // Empty payload: the whole list as paged PEER_LIST frames, served from the shared
+            // snapshot. "since=<version>;<epoch>": only the changes after that version as
+            // PEER_DELTA.
+            if (payload.compare(0, 6, "since=") == 0) {
+                string cursor(payload.substr(6)); // no epoch: a full listing
+                char *end;
+                uint64_t since = strtoull(cursor.c_str(), &end, 10);
+                uint64_t epoch = *end == ';' ? strtoull(end + 1, nullptr, 10) : 0;
+                appendPeerDeltaFrames(out, h.seq, members.changesSince(since, epoch), members.pageBytes());
+            } else {
+                appendPeerListFrames(out, h.seq, *members.snapshot());
+            }
+            break;
+        case MsgType::Dead:
+            // payload: comma-delimited <DeadNode.IP>:<DeadNode.Port> list, originId identifies
+            // the reporter.
+            while (!payload.empty()) {
+                size_t comma = payload.find(',');
+                if (splitHostPort(payload.substr(0, comma), ip, port)) {
+                    string key = ip + ":" + port;
+                    if (ownsPeer(key)) {
+                        if (!ring.empty())
+                            tombstone(key);
+                        removePeer(ip, port);
+                    }
+                    forwardToOwners(h, key, true);
+                }
+                payload = comma == string_view::npos ? string_view() : payload.substr(comma + 1);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    static long processRssKb() {
+        ifstream status("/proc/self/status");
+        string line;
+        while (getline(status, line)) {
+            if (line.compare(0, 6, "VmRSS:") == 0)
+                return atol(line.c_str() + 6);
+        }
+        return 0;
+    }
+
+    // Returns "accepted=<n> active=<n> conn/s=<rate> process_rss_kb=<kb> rss_growth_per_conn_b=<bytes>".
+    // RSS is the whole process's. The per-connection figure divides its growth since this seed
+    // started listening by the open connections, so it only describes the seed when nothing
+    // else in the process (other seeds, simulated peers) grew meanwhile.
+    string statsSummary() {
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        long accepted = connectionsAccepted.load();
+        long active = connectionsActive.load();
+        long rssKb = processRssKb();
+        long growthKb = max(0L, rssKb - idleRssKb);
         ostringstream oss;
-        for (auto &entry : peerList)
-            oss << entry.first << ",";
-        string list = oss.str();
-        if (!list.empty()) list.pop_back();
-        return list;
+        oss << "Seed " << seedID << " - accepted=" << accepted << " active=" << active
+            << " conn/s=" << (secs > 0 ? accepted / secs : 0.0) << " process_rss_kb=" << rssKb
+            << " rss_growth_per_conn_b=" << (active > 0 ? growthKb * 1024 / active : 0);
+        if (journal)
+            oss << " " << journal->summary();
+        return oss.str();
     }
 
     // Handles an individual peer connection.
     void handleClient(int client_sock) {
-        char buffer[1024] = {0};
+        FrameReader reader(SEED_READ_BUFFER);
+        string reply;
         int valread;
-        while ((valread = read(client_sock, buffer, 1024)) > 0) {
-            buffer[valread] = '\0';
-            string request(buffer);
-            istringstream iss(request);
-            string cmd;
-            iss >> cmd;
-            if (cmd == "REGISTER") {
-                string ip, port;
-                iss >> ip >> port;
-                addPeer(ip, port);
-            } else if (cmd == "GET_PEERS") {
-                string list = getPeerList();
-                send(client_sock, list.c_str(), list.size(), 0);
-            } else if (cmd == "DEAD") {
-                // Format: DEAD <DeadNode.IP> <DeadNode.Port> <timestamp> <reporter.IP>
-                string ip, port, timestamp, reporter;
-                iss >> ip >> port >> timestamp >> reporter;
-                removePeer(ip, port);
+        while ((valread = read(client_sock, reader.writePtr(), reader.writable())) > 0) {
+            reader.commit(valread);
+            reader.consume([&](const FrameHeader &h, string_view payload) {
+                processFrame(h, payload, reply);
+                return true;
+            });
+            if (reader.error())
+                break;
+            if (!reply.empty()) {
+                send(client_sock, reply.data(), reply.size(), MSG_NOSIGNAL);
+                reply.clear();
             }
-            memset(buffer, 0, 1024);
         }
         close(client_sock);
+        connectionsActive--;
     }
 
     void run() {
+        if (mode == SeedMode::Reactor) {
+            runReactor();
+            return;
+        }
         while (true) {
             struct sockaddr_in clientAddr;
             socklen_t addrlen = sizeof(clientAddr);
@@ -123,8 +398,156 @@ if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
                 perror("Accept failed");
                 continue;
             }
+            connectionsAccepted++;
+            connectionsActive++;
             thread t(&SeedServer::handleClient, this, client_sock);
             t.detach();
         }
     }
+
+    // ------------------------------
+    // Reactor mode
+    // ------------------------------
+    // Per-connection state is a small frame buffer plus the unsent part of a reply, so an idle
+    // connection costs a few hundred bytes plus the kernel socket instead of a thread stack.
+    // Seed requests are tiny, so connections start with a small receive buffer.
+    static const size_t SEED_READ_BUFFER = 256;
+    // A client that keeps sending requests without reading the replies stops being read once
+    // this much reply data is unsent; reading resumes when EPOLLOUT has drained it below.
+    static const size_t PENDING_HIGH_WATERMARK = 1 << 20;
+
+    struct ReactorConn {
+        int fd;
+        string pending;
+        bool wantWrite;   // EPOLLOUT currently armed
+        bool readPaused;  // stopped reading with pending over PENDING_HIGH_WATERMARK
+        FrameReader reader;
+    };
+
+    // Runs reactorThreads event loops. Every loop watches the shared listening socket with
+    // EPOLLEXCLUSIVE, so the kernel wakes one loop per incoming connection and the accepted
+    // socket stays on that loop for its lifetime. Blocks forever.
+    void runReactor() {
+        raiseFdLimit();
+        int flags = fcntl(server_fd, F_GETFL, 0);
+        fcntl(server_fd, F_SETFL, flags | O_NONBLOCK);
+        vector<unique_ptr<EventLoop>> loops;
+        for (int i = 0; i < reactorThreads; i++) {
+            loops.push_back(make_unique<EventLoop>());
+            EventLoop *loop = loops.back().get();
+            loop->add(server_fd, EPOLLIN | EPOLLEXCLUSIVE, [this, loop](uint32_t) { acceptReady(*loop); });
+        }
+        string logMsg = "Seed " + seedID + " - reactor mode with " + to_string(reactorThreads) + " event loops";
+        logLine(logMsg);
+        vector<thread> workers;
+        for (size_t i = 1; i < loops.size(); i++)
+            workers.emplace_back(&EventLoop::run, loops[i].get());
+        loops[0]->run();
+        for (auto &t : workers)
+            t.join();
+    }
+
+    // Tens of thousands of concurrent peers need more descriptors than the usual soft limit.
+    void raiseFdLimit() {
+        struct rlimit rl;
+        if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+            rl.rlim_cur = rl.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &rl);
+        }
+    }
+
+    void acceptReady(EventLoop &loop) {
+        while (true) {
+            int fd = accept4(server_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    perror("Accept failed");
+                return;
+            }
+            connectionsAccepted++;
+            connectionsActive++;
+            ReactorConn *conn = new ReactorConn{fd, "", false, false, FrameReader(SEED_READ_BUFFER)};
+            loop.add(fd, EPOLLIN | EPOLLRDHUP | EPOLLET,
+                     [this, &loop, conn](uint32_t events) { connReady(loop, conn, events); });
+        }
+    }
+
+    void closeConn(EventLoop &loop, ReactorConn *conn) {
+        loop.remove(conn->fd);
+        close(conn->fd);
+        delete conn;
+        connectionsActive--;
+    }
+
+    // Edge-triggered: drains the socket until EAGAIN and handles every complete frame, unless the
+    // unsent replies pass PENDING_HIGH_WATERMARK. A paused connection has no new edge coming for
+    // the input it left unread, so it is read again as soon as a flush brings pending below.
+    void connReady(EventLoop &loop, ReactorConn *conn, uint32_t events) {
+        if (events & (EPOLLERR | EPOLLHUP)) {
+            closeConn(loop, conn);
+            return;
+        }
+        if ((events & EPOLLOUT) && !flushConn(loop, conn))
+            return;
+        bool resume = conn->readPaused && conn->pending.size() < PENDING_HIGH_WATERMARK;
+        if (resume)
+            conn->readPaused = false;
+        if (!conn->readPaused && (resume || (events & (EPOLLIN | EPOLLRDHUP)))) {
+            while (true) {
+                if (conn->pending.size() >= PENDING_HIGH_WATERMARK) {
+                    conn->readPaused = true; // flushConn() left EPOLLOUT armed
+                    break;
+                }
+                ssize_t n = read(conn->fd, conn->reader.writePtr(), conn->reader.writable());
+                if (n > 0) {
+                    conn->reader.commit(n);
+                    conn->reader.consume([&](const FrameHeader &h, string_view payload) {
+                        processFrame(h, payload, conn->pending);
+                        return true;
+                    });
+                    if (conn->reader.error()) {
+                        closeConn(loop, conn);
+                        return;
+                    }
+                    if (!conn->pending.empty() && !flushConn(loop, conn))
+                        return;
+                    continue;
+                }
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                    break;
+                closeConn(loop, conn); // EOF or hard error
+                return;
+            }
+        }
+    }
+
+    // Sends as much of conn->pending as the socket accepts and arms EPOLLOUT for the rest.
+    // Returns false if the connection was closed.
+    bool flushConn(EventLoop &loop, ReactorConn *conn) {
+        size_t off = 0;
+        while (off < conn->pending.size()) {
+            ssize_t n = send(conn->fd, conn->pending.data() + off, conn->pending.size() - off, MSG_NOSIGNAL);
+            if (n > 0) {
+                off += n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            closeConn(loop, conn);
+            return false;
+        }
+        conn->pending.erase(0, off);
+        bool wantWrite = !conn->pending.empty();
+        if (wantWrite != conn->wantWrite) {
+            conn->wantWrite = wantWrite;
+            loop.modify(conn->fd, EPOLLIN | EPOLLRDHUP | EPOLLET | (wantWrite ? (uint32_t)EPOLLOUT : 0u));
+        }
+        return true;
+    }
 };
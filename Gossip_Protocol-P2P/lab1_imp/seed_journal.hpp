@@ -0,0 +1,384 @@
+// seed_journal.hpp
+/*
+  SeedJournal: durable membership for a SeedServer, so a restarted seed serves its old peer
+  list at once instead of waiting for every peer to register again.
+
+    • Every membership change is appended to a binary write-ahead log:
+          op (1: add, 2: remove) | len: u16 | addr[len] | version: u64 | check: u32   (big-endian)
+      version is the table version the change produced and check is the low 32 bits of
+      hashMessage(op + addr + version); a torn record at the tail is detected by it and cut
+      off on recovery.
+    • Every snapshotEvery changes the log is renamed to seed-<port>.wal.1 and a new one is
+      started. A background thread then writes the table's immutable snapshot (taken at the
+      rotation) through a memory-mapped temporary file and renames it over the snapshot:
+          "GSNP" | format: u32 | entries: u64 | check: u64 | epoch: u64 | version: u64 |
+          entries of (len: u16 | addr)
+      check covers everything after itself. Once the snapshot is in place the rotated log is
+      deleted; if writing it fails, the rotated log stays and the next attempt covers it too.
+      add() and remove() never wait for a snapshot.
+    • recover() maps the snapshot, restores its epoch and version, then replays the rotated
+      log and the log, skipping records the snapshot already holds, and reports how long it
+      took. Peers' delta cursors therefore stay valid across a restart. If the records do not
+      continue the snapshot's version exactly, the table starts a new epoch instead.
+
+  Writes go to the page cache, which survives a crash of the seed process; syncWrites adds an
+  fdatasync() per record for surviving power loss as well. Recovered peers that died while the
+  seed was down are removed by the usual DEAD reports.
+
+  Thread-safe. Changes go through add()/remove(), which update the MembershipTable and the log
+  under one lock so the log order and versions match the table's.
+*/
+#pragma once
+#include <endian.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "dedup.hpp"
+#include "membership.hpp"
+
+struct JournalConfig {
+    std::string dir = ".";      // holds seed-<port>.wal and seed-<port>.snap
+    size_t snapshotEvery = 4096; // log records between snapshots
+    bool syncWrites = false;     // fdatasync() every log record
+};
+
+struct RecoveryStats {
+    size_t snapshotEntries = 0;
+    size_t logRecords = 0;
+    size_t members = 0;
+    bool tornTail = false;       // the log ended in a partial or corrupt record
+    bool versionsKept = false;   // the previous run's epoch and versions were restored
+    double millis = 0;
+};
+
+class SeedJournal {
+public:
+    static const uint8_t OP_ADD = 1;
+    static const uint8_t OP_REMOVE = 2;
+    static const uint32_t SNAPSHOT_FORMAT = 2;
+    static const size_t SNAPSHOT_HEADER = 40;
+
+    SeedJournal(const JournalConfig &cfg, int port)
+        : cfg_(cfg), walPath_(cfg.dir + "/seed-" + std::to_string(port) + ".wal"),
+          oldWalPath_(walPath_ + ".1"), snapPath_(cfg.dir + "/seed-" + std::to_string(port) + ".snap") {}
+
+    ~SeedJournal() {
+        if (snapshotThread_.joinable())
+            snapshotThread_.join();
+        if (walFd_ >= 0)
+            close(walFd_);
+    }
+
+    SeedJournal(const SeedJournal &) = delete;
+    SeedJournal &operator=(const SeedJournal &) = delete;
+
+    // Loads the snapshot and log into members (call once, before serving) and opens the log
+    // for appending. Returns false if the log cannot be opened.
+    bool recover(MembershipTable &members, RecoveryStats &stats) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto start = std::chrono::steady_clock::now();
+        stats = RecoveryStats();
+        bool exact = loadSnapshot(members, stats);
+        bool restored = exact;
+        replayLog(oldWalPath_, members, stats, exact);
+        stats.tornTail = false; // a bad record in the rotated log is skipped, not cut
+        size_t validBytes = replayLog(walPath_, members, stats, exact);
+        if (restored && !exact)
+            members.renewEpoch();
+        stats.versionsKept = exact;
+        walFd_ = open(walPath_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (walFd_ < 0) {
+            perror(("open " + walPath_).c_str());
+            return false;
+        }
+        if (stats.tornTail && ftruncate(walFd_, validBytes) < 0)
+            perror("ftruncate");
+        oldWalExists_ = access(oldWalPath_.c_str(), F_OK) == 0;
+        recordsSinceSnapshot_ = stats.logRecords;
+        stats.members = members.size();
+        stats.millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        // Start the new run from a compact snapshot rather than a growing log; a first run
+        // writes one too, so the table's epoch is on disk from the start.
+        if (stats.logRecords > 0 || !restored) {
+            if (writeSnapshotFile(*members.snapshot(), members.epoch())) {
+                unlink(oldWalPath_.c_str());
+                oldWalExists_ = false;
+                if (ftruncate(walFd_, 0) < 0)
+                    failures_++;
+                recordsSinceSnapshot_ = 0;
+                snapshots_++;
+            } else {
+                failures_++;
+            }
+        }
+        return true;
+    }
+
+    // Returns true if addr was not a member.
+    bool add(MembershipTable &members, const std::string &addr) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!members.add(addr))
+            return false;
+        append(members, OP_ADD, addr);
+        return true;
+    }
+
+    // Returns true if addr was a member.
+    bool remove(MembershipTable &members, const std::string &addr) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!members.remove(addr))
+            return false;
+        append(members, OP_REMOVE, addr);
+        return true;
+    }
+
+    // "journal records=<n> bytes=<n> snapshots=<n> last_snapshot_ms=<x> failures=<n>"
+    std::string summary() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        std::ostringstream oss;
+        oss << "journal records=" << records_ << " bytes=" << bytes_ << " snapshots=" << snapshots_
+            << " last_snapshot_ms=" << lastSnapshotMs_ << " failures=" << failures_;
+        return oss.str();
+    }
+
+private:
+    JournalConfig cfg_;
+    std::string walPath_, oldWalPath_, snapPath_;
+    std::mutex mtx_; // orders table changes with their log records; guards the fields below
+    int walFd_ = -1;
+    bool oldWalExists_ = false; // rotated log not yet covered by a snapshot
+    bool snapshotting_ = false;
+    std::thread snapshotThread_;
+    size_t recordsSinceSnapshot_ = 0;
+    uint64_t records_ = 0, bytes_ = 0, snapshots_ = 0, failures_ = 0;
+    double lastSnapshotMs_ = 0;
+
+    // version is big-endian, as stored in the record.
+    static uint32_t recordCheck(uint8_t op, std::string_view addr, uint64_t version) {
+        std::string text(1, (char)op);
+        text.append(addr);
+        text.append((const char *)&version, 8);
+        return (uint32_t)hashMessage(text);
+    }
+
+    void append(MembershipTable &members, uint8_t op, const std::string &addr) {
+        if (walFd_ < 0)
+            return;
+        std::string rec;
+        rec.reserve(15 + addr.size());
+        rec.push_back((char)op);
+        uint16_t len = htobe16((uint16_t)std::min<size_t>(addr.size(), UINT16_MAX));
+        rec.append((const char *)&len, 2);
+        rec.append(addr, 0, be16toh(len));
+        uint64_t version = htobe64(members.version()); // every change holds mtx_
+        rec.append((const char *)&version, 8);
+        uint32_t check = htobe32(recordCheck(op, std::string_view(addr).substr(0, be16toh(len)), version));
+        rec.append((const char *)&check, 4);
+        if (write(walFd_, rec.data(), rec.size()) != (ssize_t)rec.size()) {
+            failures_++;
+            return;
+        }
+        if (cfg_.syncWrites)
+            fdatasync(walFd_);
+        records_++;
+        bytes_ += rec.size();
+        if (++recordsSinceSnapshot_ >= cfg_.snapshotEvery)
+            startSnapshot(members);
+    }
+
+    // Rotates the log and hands the table's current snapshot to a background writer. The
+    // caller holds mtx_ and pays only for the rename and the snapshot string.
+    void startSnapshot(MembershipTable &members) {
+        if (snapshotting_)
+            return; // retried with the next record
+        if (snapshotThread_.joinable())
+            snapshotThread_.join();
+        if (!oldWalExists_) {
+            int fd = -1;
+            if (rename(walPath_.c_str(), oldWalPath_.c_str()) == 0) {
+                fd = open(walPath_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+                if (fd < 0 && rename(oldWalPath_.c_str(), walPath_.c_str()) < 0)
+                    perror(("rename " + oldWalPath_).c_str());
+            }
+            if (fd >= 0) {
+                close(walFd_);
+                walFd_ = fd;
+                oldWalExists_ = true;
+            } else {
+                failures_++; // keep appending to the unrotated log; the snapshot still helps
+            }
+        }
+        recordsSinceSnapshot_ = 0;
+        snapshotting_ = true;
+        auto snap = members.snapshot(); // consistent: every change holds mtx_
+        uint64_t epoch = members.epoch();
+        snapshotThread_ = std::thread([this, snap, epoch] {
+            auto start = std::chrono::steady_clock::now();
+            bool ok = writeSnapshotFile(*snap, epoch);
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (ok) {
+                // Every record in the rotated log precedes the snapshot.
+                if (oldWalExists_)
+                    unlink(oldWalPath_.c_str());
+                oldWalExists_ = false;
+                snapshots_++;
+                lastSnapshotMs_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            } else {
+                failures_++;
+            }
+            snapshotting_ = false;
+        });
+    }
+
+    // Writes snap to a mapped temporary file and renames it over the snapshot. Touches no
+    // journal state, so it runs without mtx_.
+    bool writeSnapshotFile(const PeerListSnapshot &snap, uint64_t epoch) {
+        // Header, then each entry's length (2 bytes) and address; the list has entries - 1 commas.
+        size_t entries = snap.members;
+        size_t size = SNAPSHOT_HEADER + (entries ? snap.list.size() + 1 + entries : 0);
+        std::string tmp = snapPath_ + ".tmp";
+        int fd = open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0 || ftruncate(fd, size) < 0) {
+            if (fd >= 0)
+                close(fd);
+            return false;
+        }
+        char *base = (char *)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        char *p = base + SNAPSHOT_HEADER;
+        std::string_view list = snap.list;
+        while (!list.empty()) {
+            size_t comma = list.find(',');
+            std::string_view addr = list.substr(0, comma);
+            uint16_t len = htobe16((uint16_t)addr.size());
+            memcpy(p, &len, 2);
+            memcpy(p + 2, addr.data(), addr.size());
+            p += 2 + addr.size();
+            list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+        }
+        uint32_t format = htobe32(SNAPSHOT_FORMAT);
+        uint64_t count = htobe64(entries);
+        uint64_t savedEpoch = htobe64(epoch);
+        uint64_t version = htobe64(snap.version);
+        memcpy(base + 24, &savedEpoch, 8);
+        memcpy(base + 32, &version, 8);
+        uint64_t check = htobe64(hashMessage(std::string_view(base + 24, p - base - 24)));
+        memcpy(base, "GSNP", 4);
+        memcpy(base + 4, &format, 4);
+        memcpy(base + 8, &count, 8);
+        memcpy(base + 16, &check, 8);
+        bool ok = msync(base, size, MS_SYNC) == 0;
+        munmap(base, size);
+        close(fd);
+        return ok && rename(tmp.c_str(), snapPath_.c_str()) == 0;
+    }
+
+    // Restores the snapshot's entries, epoch and version into members. Returns true if it did.
+    bool loadSnapshot(MembershipTable &members, RecoveryStats &stats) {
+        int fd = open(snapPath_.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) < 0 || st.st_size < (off_t)SNAPSHOT_HEADER) {
+            close(fd);
+            return false;
+        }
+        size_t size = st.st_size;
+        const char *base = (const char *)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED)
+            return false;
+        uint32_t format;
+        uint64_t count, check, epoch, version;
+        memcpy(&format, base + 4, 4);
+        memcpy(&count, base + 8, 8);
+        memcpy(&check, base + 16, 8);
+        memcpy(&epoch, base + 24, 8);
+        memcpy(&version, base + 32, 8);
+        std::string_view body(base + SNAPSHOT_HEADER, size - SNAPSHOT_HEADER);
+        bool ok = memcmp(base, "GSNP", 4) == 0 && be32toh(format) == SNAPSHOT_FORMAT &&
+                  hashMessage(std::string_view(base + 24, size - 24)) == be64toh(check);
+        if (ok) {
+            madvise((void *)base, size, MADV_SEQUENTIAL);
+            std::vector<std::string> entries;
+            entries.reserve(be64toh(count));
+            size_t off = 0;
+            for (uint64_t i = 0, n = be64toh(count); i < n && off + 2 <= body.size(); i++) {
+                uint16_t len;
+                memcpy(&len, body.data() + off, 2);
+                len = be16toh(len);
+                if (off + 2 + len > body.size())
+                    break;
+                entries.emplace_back(body.substr(off + 2, len));
+                off += 2 + len;
+            }
+            stats.snapshotEntries = entries.size();
+            members.restore(be64toh(epoch), be64toh(version), std::move(entries));
+        } else {
+            fprintf(stderr, "%s: bad snapshot ignored\n", snapPath_.c_str());
+        }
+        munmap((void *)base, size);
+        return ok;
+    }
+
+    // Applies every whole, intact record of the log at path that the table does not already
+    // hold; returns the length of that valid prefix. exact is cleared unless each applied record
+    // produces exactly the version it was logged with.
+    size_t replayLog(const std::string &path, MembershipTable &members, RecoveryStats &stats, bool &exact) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return 0;
+        struct stat st;
+        size_t size = fstat(fd, &st) == 0 ? st.st_size : 0;
+        if (size == 0) {
+            close(fd);
+            return 0;
+        }
+        const char *base = (const char *)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED)
+            return 0;
+        size_t off = 0;
+        while (off + 3 <= size) {
+            uint8_t op = (uint8_t)base[off];
+            uint16_t len;
+            memcpy(&len, base + off + 1, 2);
+            len = be16toh(len);
+            if (off + 15 + len > size)
+                break;
+            std::string_view addr(base + off + 3, len);
+            uint64_t version;
+            uint32_t check;
+            memcpy(&version, base + off + 3 + len, 8);
+            memcpy(&check, base + off + 11 + len, 4);
+            if ((op != OP_ADD && op != OP_REMOVE) || be32toh(check) != recordCheck(op, addr, version))
+                break;
+            version = be64toh(version);
+            stats.logRecords++;
+            off += 15 + len;
+            if (exact && version <= members.version())
+                continue; // already in the snapshot
+            bool changed = op == OP_ADD ? members.add(std::string(addr)) : members.remove(std::string(addr));
+            if (!changed || members.version() != version)
+                exact = false;
+        }
+        stats.tornTail = off != size;
+        munmap((void *)base, size);
+        return off;
+    }
+};
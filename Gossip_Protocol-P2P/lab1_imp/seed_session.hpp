@@ -0,0 +1,437 @@
+// seed_session.hpp
+/*
+  SeedSession: one long-lived, nonblocking connection from a peer to one seed, driven by the
+  peer's EventLoop.
+
+    • REGISTER, GET_PEERS and DEAD requests are multiplexed over the same socket. GET_PEERS
+      requests carry a sequence number that the seed echoes in its PEER_LIST / PEER_DELTA
+      reply pages, so any number of them can be in flight; pages are reassembled before the
+      handler runs.
+    • DEAD reports made within deadBatchDelay of each other are sent as one DEAD frame whose
+      payload is a comma-delimited "IP:Port" list.
+    • forwardRegister() sends REGISTER for some other address; seeds use it to hand a
+      registration to the seeds that own it (ring.hpp). Forwards made while disconnected are
+      sent after the next connect.
+    • If the connection fails or drops, the session reconnects with exponential backoff
+      (reconnectMin doubling up to reconnectMax, with jitter). DEAD reports and forwarded
+      REGISTERs that had not been written to the socket go back on their queues. After
+      reconnecting it re-registers, re-sends unanswered GET_PEERS and flushes both queues.
+      While disconnected each queue holds at most maxQueued addresses; beyond that the
+      oldest are dropped and counted.
+
+  All methods must be called on the loop thread.
+*/
+#pragma once
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "event_loop.hpp"
+#include "wire.hpp"
+#include "membership.hpp"
+
+struct SeedSessionConfig {
+    std::chrono::milliseconds reconnectMin{100};
+    std::chrono::milliseconds reconnectMax{10000};
+    std::chrono::milliseconds deadBatchDelay{20}; // DEAD reports this close together share a frame
+    size_t maxQueued = 4096; // DEAD reports and forwarded REGISTERs kept while disconnected, each
+};
+
+class SeedSession {
+public:
+    using PeerListHandler = std::function<void(std::string_view peers)>;
+    using PeerDeltaHandler = std::function<void(const PeerDelta &delta)>;
+
+    SeedSession(EventLoop &loop, const std::string &host, int port, uint64_t originId,
+                const SeedSessionConfig &cfg = SeedSessionConfig())
+        : loop_(loop), host_(host), port_(port), originId_(originId), cfg_(cfg),
+          rng_(std::random_device{}()), reader_(4096) {}
+
+    ~SeedSession() {
+        loop_.cancel(reconnectTimer_);
+        loop_.cancel(deadTimer_);
+        closeSocket();
+    }
+
+    SeedSession(const SeedSession &) = delete;
+    SeedSession &operator=(const SeedSession &) = delete;
+
+    void start() {
+        if (state_ == State::Idle)
+            connectNow();
+    }
+
+    // Registers selfAddr ("IP:Port") now and again after every reconnect.
+    void registerPeer(const std::string &selfAddr) {
+        selfAddr_ = selfAddr;
+        if (state_ == State::Connected)
+            sendFrame(MsgType::Register, 0, selfAddr_);
+        start();
+    }
+
+    // onList runs once, with the seed's whole comma-delimited peer list.
+    void getPeers(PeerListHandler onList) {
+        Request req;
+        req.onList = std::move(onList);
+        sendRequest(std::move(req));
+    }
+
+    // onDelta runs once, with the membership changes after version `since` of the seed's table
+    // incarnation `epoch` (0 for none yet: everything, as a full listing).
+    void getPeerDelta(uint64_t since, uint64_t epoch, PeerDeltaHandler onDelta) {
+        Request req;
+        req.onDelta = std::move(onDelta);
+        req.since = since;
+        req.epoch = epoch;
+        sendRequest(std::move(req));
+    }
+
+    void forwardRegister(const std::string &addr) {
+        if (state_ == State::Connected)
+            sendFrame(MsgType::Register, 0, addr);
+        else
+            enqueue(registerQueue_, addr);
+        start();
+    }
+
+    void reportDead(const std::string &nbr) {
+        enqueue(deadQueue_, nbr);
+        if (deadTimer_ == 0)
+            deadTimer_ = loop_.runAfter(cfg_.deadBatchDelay, [this] {
+                deadTimer_ = 0;
+                flushDead();
+            });
+        start();
+    }
+
+    bool connected() const { return state_ == State::Connected; }
+    const std::string &seedAddr() const { return seedAddr_; }
+
+    std::string summary() const {
+        std::ostringstream oss;
+        oss << "seed_session " << host_ << ":" << port_ << " connected=" << connected()
+            << " connects=" << connects_ << " failures=" << failures_ << " frames_sent=" << framesSent_
+            << " dead_reports=" << deadReports_ << " dead_frames=" << deadFrames_
+            << " outstanding_get_peers=" << outstanding_.size() << " dropped=" << dropped_;
+        return oss.str();
+    }
+
+private:
+    enum class State { Idle, Connecting, Connected, Backoff };
+
+    struct Request {
+        PeerListHandler onList;
+        PeerDeltaHandler onDelta; // set for delta requests
+        uint64_t since = 0;
+        uint64_t epoch = 0;
+        std::string list;         // PEER_LIST pages received so far
+        PeerDelta delta;          // PEER_DELTA pages received so far
+    };
+
+    EventLoop &loop_;
+    std::string host_;
+    int port_;
+    std::string seedAddr_ = host_ + ":" + std::to_string(port_);
+    uint64_t originId_;
+    SeedSessionConfig cfg_;
+    std::mt19937 rng_;
+    State state_ = State::Idle;
+    int fd_ = -1;
+    bool wantWrite_ = false;
+    std::string pending_;   // whole frames; the first headSent_ bytes are already written
+    size_t headSent_ = 0;
+    FrameReader reader_;
+    std::string selfAddr_;
+    uint64_t requestSeq_ = 0;
+    std::map<uint64_t, Request> outstanding_; // GET_PEERS seq -> request
+    std::deque<std::string> deadQueue_;
+    std::deque<std::string> registerQueue_; // forwardRegister() calls made while disconnected
+    EventLoop::TimerId deadTimer_ = 0;
+    EventLoop::TimerId reconnectTimer_ = 0;
+    int attempts_ = 0; // consecutive failed connection attempts
+    uint64_t connects_ = 0;
+    uint64_t failures_ = 0;
+    uint64_t framesSent_ = 0;
+    uint64_t deadReports_ = 0;
+    uint64_t deadFrames_ = 0;
+    uint64_t dropped_ = 0;  // queued addresses dropped at maxQueued
+
+    void connectNow() {
+        reader_ = FrameReader(4096);
+        fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd_ < 0) {
+            perror("Socket failed for seed session");
+            scheduleReconnect();
+            return;
+        }
+        struct sockaddr_in servAddr;
+        memset(&servAddr, 0, sizeof(servAddr));
+        servAddr.sin_family = AF_INET;
+        servAddr.sin_port = htons(port_);
+        if (inet_pton(AF_INET, host_.c_str(), &servAddr.sin_addr) <= 0) {
+            fprintf(stderr, "Invalid seed address %s\n", host_.c_str());
+            closeSocket();
+            scheduleReconnect();
+            return;
+        }
+        if (connect(fd_, (struct sockaddr *)&servAddr, sizeof(servAddr)) < 0 && errno != EINPROGRESS) {
+            closeSocket();
+            scheduleReconnect();
+            return;
+        }
+        state_ = State::Connecting;
+        wantWrite_ = true;
+        loop_.add(fd_, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, [this](uint32_t events) { ready(events); });
+    }
+
+    void closeSocket() {
+        if (fd_ < 0)
+            return;
+        loop_.remove(fd_);
+        close(fd_);
+        fd_ = -1;
+    }
+
+    void scheduleReconnect() {
+        state_ = State::Backoff;
+        failures_++;
+        auto delay = cfg_.reconnectMin * (1LL << std::min(attempts_, 16));
+        if (delay > cfg_.reconnectMax)
+            delay = cfg_.reconnectMax;
+        attempts_++;
+        std::uniform_int_distribution<long long> jitter(delay.count() / 2, delay.count());
+        reconnectTimer_ = loop_.runAfter(std::chrono::milliseconds(jitter(rng_)), [this] {
+            reconnectTimer_ = 0;
+            connectNow();
+        });
+    }
+
+    void fail() {
+        closeSocket();
+        requeuePending();
+        scheduleReconnect();
+    }
+
+    // Adds addr to a DEAD or REGISTER queue, dropping the oldest entries beyond maxQueued.
+    void enqueue(std::deque<std::string> &queue, std::string addr) {
+        queue.push_back(std::move(addr));
+        trim(queue);
+    }
+
+    void trim(std::deque<std::string> &queue) {
+        while (queue.size() > cfg_.maxQueued) {
+            queue.pop_front();
+            dropped_++;
+        }
+    }
+
+    // Puts the DEAD reports and forwarded REGISTERs of frames the socket never fully took back
+    // in front of their queues. GET_PEERS is re-sent from outstanding_ and our own REGISTER on
+    // every connect, so those frames are dropped.
+    void requeuePending() {
+        std::deque<std::string> deads, registers;
+        for (size_t off = 0; off + FRAME_HEADER_SIZE <= pending_.size();) {
+            FrameHeader h = decodeHeader(pending_.data() + off);
+            std::string_view payload(pending_.data() + off + FRAME_HEADER_SIZE, h.payloadLen);
+            off += FRAME_HEADER_SIZE + h.payloadLen;
+            if (h.type == MsgType::Register && payload != selfAddr_) {
+                registers.emplace_back(payload);
+            } else if (h.type == MsgType::Dead) {
+                deadFrames_--;
+                while (!payload.empty()) {
+                    size_t comma = payload.find(',');
+                    deads.emplace_back(payload.substr(0, comma));
+                    deadReports_--;
+                    payload = comma == std::string_view::npos ? std::string_view() : payload.substr(comma + 1);
+                }
+            }
+        }
+        pending_.clear();
+        headSent_ = 0;
+        for (auto &addr : deadQueue_)
+            deads.push_back(std::move(addr));
+        for (auto &addr : registerQueue_)
+            registers.push_back(std::move(addr));
+        deadQueue_.swap(deads);
+        registerQueue_.swap(registers);
+        trim(deadQueue_);
+        trim(registerQueue_);
+    }
+
+    void onConnected() {
+        state_ = State::Connected;
+        attempts_ = 0;
+        connects_++;
+        // Replay session state: the seed may have restarted or never seen the earlier requests.
+        if (!selfAddr_.empty())
+            sendFrame(MsgType::Register, 0, selfAddr_, false);
+        for (auto &addr : registerQueue_)
+            sendFrame(MsgType::Register, 0, addr, false);
+        registerQueue_.clear();
+        for (auto &entry : outstanding_) {
+            entry.second.list.clear();
+            entry.second.delta = PeerDelta();
+            sendGetPeers(entry.first, entry.second, false);
+        }
+        if (deadTimer_ == 0)
+            flushDead();
+        flush();
+    }
+
+    void ready(uint32_t events) {
+        if (state_ == State::Connecting) {
+            int soError = 0;
+            socklen_t soLen = sizeof(soError);
+            getsockopt(fd_, SOL_SOCKET, SO_ERROR, &soError, &soLen);
+            if (soError != 0 || (events & (EPOLLERR | EPOLLHUP))) {
+                fail();
+                return;
+            }
+            if (!(events & EPOLLOUT))
+                return;
+            onConnected();
+            if (state_ != State::Connected)
+                return;
+        }
+        if (events & (EPOLLERR | EPOLLHUP)) {
+            fail();
+            return;
+        }
+        if ((events & EPOLLOUT) && !flush())
+            return;
+        if (!(events & (EPOLLIN | EPOLLRDHUP)))
+            return;
+        while (true) {
+            ssize_t n = read(fd_, reader_.writePtr(), reader_.writable());
+            if (n > 0) {
+                reader_.commit(n);
+                reader_.consume([&](const FrameHeader &h, std::string_view payload) {
+                    if (h.type == MsgType::PeerList || h.type == MsgType::PeerDelta)
+                        replyPage(h, payload);
+                    return state_ == State::Connected; // a handler may have failed the session
+                });
+                if (state_ != State::Connected)
+                    return;
+                if (reader_.error()) {
+                    fail();
+                    return;
+                }
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                return;
+            fail(); // seed closed the session
+            return;
+        }
+    }
+
+    void sendRequest(Request req) {
+        uint64_t seq = ++requestSeq_;
+        Request &stored = outstanding_[seq] = std::move(req);
+        if (state_ == State::Connected)
+            sendGetPeers(seq, stored, true);
+        start();
+    }
+
+    void sendGetPeers(uint64_t seq, const Request &req, bool flushNow) {
+        if (req.onDelta)
+            sendFrame(MsgType::GetPeers, seq, "since=" + std::to_string(req.since) + ";" + std::to_string(req.epoch),
+                      flushNow);
+        else
+            sendFrame(MsgType::GetPeers, seq, {}, flushNow);
+    }
+
+    // Accumulates one reply page and runs the request's handler after the last one.
+    void replyPage(const FrameHeader &h, std::string_view payload) {
+        auto it = outstanding_.find(h.seq);
+        if (it == outstanding_.end())
+            return;
+        Request &req = it->second;
+        if (h.type == MsgType::PeerList) {
+            if (!req.list.empty() && !payload.empty())
+                req.list += ',';
+            req.list.append(payload.data(), payload.size());
+        } else {
+            parsePeerDeltaPage(payload, req.delta);
+        }
+        if (h.flags & FRAME_MORE)
+            return;
+        Request done = std::move(req);
+        outstanding_.erase(it);
+        if (done.onDelta)
+            done.onDelta(done.delta);
+        else if (done.onList)
+            done.onList(done.list);
+    }
+
+    // Sends every queued DEAD report as one frame (or keeps them until the session is up).
+    void flushDead() {
+        if (deadQueue_.empty() || state_ != State::Connected)
+            return;
+        std::string payload;
+        for (auto &nbr : deadQueue_) {
+            if (!payload.empty())
+                payload += ',';
+            payload += nbr;
+        }
+        deadReports_ += deadQueue_.size();
+        deadFrames_++;
+        deadQueue_.clear();
+        sendFrame(MsgType::Dead, 0, payload);
+    }
+
+    void sendFrame(MsgType type, uint64_t seq, std::string_view payload = {}, bool flushNow = true) {
+        appendFrame(pending_, type, originId_, seq, wallClockNs(), payload);
+        framesSent_++;
+        if (flushNow)
+            flush();
+    }
+
+    // Returns false if the session failed while writing.
+    bool flush() {
+        size_t off = headSent_;
+        while (off < pending_.size()) {
+            ssize_t n = send(fd_, pending_.data() + off, pending_.size() - off, MSG_NOSIGNAL);
+            if (n > 0) {
+                off += n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            fail();
+            return false;
+        }
+        // Drop the frames written in full; a partly written one stays for requeuePending().
+        size_t done = 0;
+        while (done + FRAME_HEADER_SIZE <= off) {
+            size_t end = done + FRAME_HEADER_SIZE + decodeHeader(pending_.data() + done).payloadLen;
+            if (end > off)
+                break;
+            done = end;
+        }
+        pending_.erase(0, done);
+        headSent_ = off - done;
+        bool wantWrite = !pending_.empty();
+        if (wantWrite != wantWrite_) {
+            wantWrite_ = wantWrite;
+            loop_.modify(fd_, EPOLLIN | EPOLLRDHUP | EPOLLET | (wantWrite ? (uint32_t)EPOLLOUT : 0u));
+        }
+        return true;
+    }
+};
@@ -0,0 +1,194 @@
+// timer_wheel.hpp
+/*
+  TimerWheel: hierarchical timing wheel (Varghese & Lauck) used by EventLoop.
+
+    level 0: 256 slots of 1 tick        (256 ticks)
+    level 1:  64 slots of 256 ticks     (~16 s at 1 ms/tick)
+    level 2:  64 slots of 16384 ticks   (~17 min)
+    level 3:  64 slots of 2^20 ticks    (~18 h; longer delays are clamped to this range)
+
+  schedule/cancel are O(1); advance() fires due timers and cascades a higher-level slot into
+  the lower levels each time the level below wraps. Timer entries live in a pooled vector and
+  are recycled through a free list, and each slot keeps its vector's capacity when it is
+  emptied, so steady-state scheduling does not allocate beyond the callback itself. Periodic timers are re-inserted under the same id after every firing.
+*/
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimerId = uint64_t; // (generation << 32) | entry index; 0 is never a valid id
+    using Callback = std::function<void()>;
+
+    explicit TimerWheel(std::chrono::milliseconds tick = std::chrono::milliseconds(1))
+        : tick_(tick), start_(Clock::now()) {
+        for (int l = 0; l < LEVELS; l++)
+            slots_[l].resize(l == 0 ? L0_SLOTS : LN_SLOTS);
+    }
+
+    // Fires fn once after delay (interval zero) or every interval after the first delay,
+    // counted from now: an idle loop has not advanced the wheel for as long as it slept.
+    TimerId schedule(Clock::duration delay, Clock::duration interval, Callback fn) {
+        uint32_t idx;
+        if (!freeList_.empty()) {
+            idx = freeList_.back();
+            freeList_.pop_back();
+        } else {
+            idx = (uint32_t)entries_.size();
+            entries_.emplace_back();
+        }
+        Entry &e = entries_[idx];
+        e.generation++;
+        e.active = true;
+        e.fn = std::move(fn);
+        e.intervalTicks = interval.count() > 0 ? std::max<uint64_t>(1, toTicks(interval)) : 0;
+        uint64_t current = std::max(now_, (uint64_t)((Clock::now() - start_) / tick_));
+        e.expiry = current + std::max<uint64_t>(1, toTicks(delay));
+        insert(idx);
+        active_++;
+        return ((uint64_t)e.generation << 32) | idx;
+    }
+
+    // Safe to call from inside a callback, including the timer's own.
+    void cancel(TimerId id) {
+        uint32_t idx = (uint32_t)id;
+        if (idx >= entries_.size())
+            return;
+        Entry &e = entries_[idx];
+        if (e.generation != (uint32_t)(id >> 32) || !e.active)
+            return;
+        e.active = false;
+        e.fn = nullptr;
+        active_--;
+        // The slot still references idx; it is recycled when that slot is next processed.
+    }
+
+    size_t size() const { return active_; }
+
+    // Runs every timer whose expiry tick is <= the current time.
+    void advance(Clock::time_point now) {
+        uint64_t target = (uint64_t)((now - start_) / tick_);
+        while (now_ < target) {
+            now_++;
+            if ((now_ & (L0_SLOTS - 1)) == 0)
+                cascade(1);
+            fireSlot(slots_[0][now_ & (L0_SLOTS - 1)]);
+        }
+    }
+
+    // Milliseconds until the next level-0 slot with work (or the next cascade), -1 if idle.
+    int msUntilNext(Clock::time_point now) const {
+        if (active_ == 0)
+            return -1;
+        uint64_t ticks = 0;
+        for (uint64_t t = now_ + 1;; t++) {
+            ticks = t - now_;
+            if (!slots_[0][t & (L0_SLOTS - 1)].empty() || (t & (L0_SLOTS - 1)) == 0)
+                break;
+        }
+        auto due = start_ + tick_ * (now_ + ticks);
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(due - now).count();
+        return wait < 0 ? 0 : (int)wait + 1;
+    }
+
+private:
+    static const int LEVELS = 4;
+    static const uint64_t L0_BITS = 8, LN_BITS = 6;
+    static const uint64_t L0_SLOTS = 1 << L0_BITS, LN_SLOTS = 1 << LN_BITS;
+
+    struct Entry {
+        uint64_t expiry = 0;
+        uint64_t intervalTicks = 0;
+        uint32_t generation = 0;
+        bool active = false;
+        Callback fn;
+    };
+
+    Clock::duration tick_;
+    Clock::time_point start_;
+    uint64_t now_ = 0; // ticks processed so far
+    std::vector<Entry> entries_;
+    std::vector<uint32_t> freeList_;
+    std::vector<std::vector<uint32_t>> slots_[LEVELS];
+    size_t active_ = 0;
+
+    uint64_t toTicks(Clock::duration d) const { return (uint64_t)((d + tick_ - Clock::duration(1)) / tick_); }
+
+    static uint64_t levelShift(int level) { return level == 0 ? 0 : L0_BITS + (level - 1) * LN_BITS; }
+
+    void insert(uint32_t idx) {
+        uint64_t expiry = entries_[idx].expiry;
+        uint64_t delta = expiry - now_;
+        int level = 0;
+        if (delta >= L0_SLOTS) {
+            level = 1;
+            while (level < LEVELS - 1 && delta >= (1ULL << (levelShift(level) + LN_BITS)))
+                level++;
+        }
+        uint64_t mask = (level == 0 ? L0_SLOTS : LN_SLOTS) - 1;
+        uint64_t at = expiry;
+        if (level == LEVELS - 1 && delta >= (1ULL << (levelShift(level) + LN_BITS)))
+            at = now_ + (1ULL << (levelShift(level) + LN_BITS)) - 1; // clamp very long delays
+        slots_[level][(at >> levelShift(level)) & mask].push_back(idx);
+    }
+
+    // Redistributes the current slot of `level` into lower levels, recursing upward on wrap.
+    void cascade(int level) {
+        if (level >= LEVELS)
+            return;
+        uint64_t slot = (now_ >> levelShift(level)) & (LN_SLOTS - 1);
+        if (slot == 0)
+            cascade(level + 1);
+        // Entries always move to a lower level (or another slot), never back into this one.
+        std::vector<uint32_t> &cascading = slots_[level][slot];
+        for (uint32_t idx : cascading) {
+            if (!entries_[idx].active)
+                release(idx);
+            else
+                insert(idx);
+        }
+        cascading.clear();
+    }
+
+    void release(uint32_t idx) { freeList_.push_back(idx); }
+
+    void fireSlot(std::vector<uint32_t> &slot) {
+        if (slot.empty())
+            return;
+        // Nothing is inserted into the slot being fired (a level-0 delay of 1..255 ticks lands
+        // in another slot), so it is walked in place and cleared, keeping its capacity.
+        for (uint32_t idx : slot) {
+            Entry &e = entries_[idx];
+            if (!e.active) {
+                release(idx);
+                continue;
+            }
+            if (e.expiry > now_) { // clamped long timer, not due yet
+                insert(idx);
+                continue;
+            }
+            if (e.intervalTicks > 0) {
+                e.expiry = now_ + e.intervalTicks;
+                insert(idx);
+            } else {
+                e.active = false;
+                active_--;
+            }
+            // Move the callback out while it runs: it may schedule timers (growing entries_).
+            Callback fn = std::move(e.fn);
+            fn();
+            Entry &after = entries_[idx];
+            if (after.active)
+                after.fn = std::move(fn);  // periodic and still scheduled
+            else if (after.intervalTicks == 0)
+                release(idx);              // one-shot: no slot references it any more
+            // A periodic timer cancelled inside its callback is freed from its slot later.
+        }
+        slot.clear();
+    }
+};
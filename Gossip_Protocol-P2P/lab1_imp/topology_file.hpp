@@ -0,0 +1,198 @@
+// topology_file.hpp
+/*
+  A binary overlay topology that NetworkBuilder (pl.hpp) writes and peer launchers map.
+
+    • Layout, every field little-endian and every array at its natural alignment:
+          "GTOP" | format: u32 | nodes: u64 | edges: u64 | name_bytes: u64 | reserved: u64
+          name_offsets: u64[nodes + 1]   node i's name is names[name_offsets[i], name_offsets[i + 1])
+          offsets: u64[nodes + 1]        node i's neighbors are targets[offsets[i], offsets[i + 1])
+          targets: u32[2 * edges]        sorted within each node; every edge appears at both ends
+          types: u8[nodes]               NodeType
+          names: char[name_bytes]
+      which is a NameTable and a CsrGraph (overlay_graph.hpp) laid end to end.
+    • write_topology() fills a mapped temporary file and renames it over the target, so
+      readers never see a partial file.
+    • MappedTopology::open() maps the file and checks the header and the size: O(1), with no
+      copy. Node names and neighbor lists are read straight out of the mapping. validate() is
+      one pass over the arrays for files from untrusted places; it allocates nothing.
+
+  The arrays are used in place, so a big-endian host refuses the file rather than swapping it.
+  Errors are reported on stderr and as a false return, as in seed_journal.hpp.
+*/
+#pragma once
+#include <endian.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "overlay_graph.hpp"
+
+const uint32_t TOPOLOGY_FORMAT = 1;
+const size_t TOPOLOGY_HEADER_BYTES = 40;
+
+// Bytes of a topology file with these counts.
+inline uint64_t topology_file_bytes(uint64_t nodes, uint64_t edges, uint64_t name_bytes) {
+    return TOPOLOGY_HEADER_BYTES + 2 * (nodes + 1) * sizeof(uint64_t) + 2 * edges * sizeof(uint32_t) + nodes +
+           name_bytes;
+}
+
+// Writes names, node types and graph (same ids) to path. False, with a message, on failure.
+inline bool write_topology(const std::string& path, const NameTable& names, const std::vector<NodeType>& types,
+                           const CsrGraph& graph) {
+    if (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__) {
+        fprintf(stderr, "%s: topology files need a little-endian host\n", path.c_str());
+        return false;
+    }
+    uint64_t nodes = graph.node_count(), edges = graph.edge_count(), name_bytes = 0;
+    for (uint32_t id = 0; id < nodes; id++)
+        name_bytes += names.name(id).size();
+    uint64_t size = topology_file_bytes(nodes, edges, name_bytes);
+
+    std::string tmp = path + ".tmp";
+    int fd = open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0 || ftruncate(fd, size) < 0) {
+        perror(tmp.c_str());
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+    char* base = (char*)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror(tmp.c_str());
+        return false;
+    }
+    uint64_t header[4] = {nodes, edges, name_bytes, 0};
+    memcpy(base, "GTOP", 4);
+    memcpy(base + 4, &TOPOLOGY_FORMAT, 4);
+    memcpy(base + 8, header, sizeof(header));
+    uint64_t* name_offsets = (uint64_t*)(base + TOPOLOGY_HEADER_BYTES);
+    uint64_t* offsets = name_offsets + nodes + 1;
+    uint32_t* targets = (uint32_t*)(offsets + nodes + 1);
+    uint8_t* type_bytes = (uint8_t*)(targets + 2 * edges);
+    char* name_chars = (char*)(type_bytes + nodes);
+    name_offsets[0] = 0;
+    for (uint32_t id = 0; id < nodes; id++) {
+        std::string_view name = names.name(id);
+        memcpy(name_chars + name_offsets[id], name.data(), name.size());
+        name_offsets[id + 1] = name_offsets[id] + name.size();
+        type_bytes[id] = (uint8_t)types[id];
+    }
+    memcpy(offsets, graph.offsets.data(), (nodes + 1) * sizeof(uint64_t));
+    memcpy(targets, graph.targets.data(), 2 * edges * sizeof(uint32_t));
+    munmap(base, size);
+    if (rename(tmp.c_str(), path.c_str()) < 0) {
+        perror(path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// A topology file mapped read-only. Ids are the writer's.
+class MappedTopology {
+public:
+    MappedTopology() = default;
+    MappedTopology(const MappedTopology&) = delete;
+    MappedTopology& operator=(const MappedTopology&) = delete;
+
+    ~MappedTopology() {
+        if (base_)
+            munmap((void*)base_, size_);
+    }
+
+    // Maps path and checks its header and size. False, with a message, if it is not a
+    // topology file this host can use.
+    bool open(const std::string& path) {
+        auto fail = [&](const char* why) {
+            fprintf(stderr, "%s: %s\n", path.c_str(), why);
+            return false;
+        };
+        if (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+            return fail("topology files need a little-endian host");
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            perror(path.c_str());
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0 || st.st_size < (off_t)TOPOLOGY_HEADER_BYTES) {
+            close(fd);
+            return fail("not a topology file");
+        }
+        size_t size = st.st_size;
+        const char* base = (const char*)mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) {
+            perror(path.c_str());
+            return false;
+        }
+        uint32_t format;
+        uint64_t header[4];
+        memcpy(&format, base + 4, 4);
+        memcpy(header, base + 8, sizeof(header));
+        uint64_t nodes = header[0], edges = header[1], name_bytes = header[2];
+        bool ok = memcmp(base, "GTOP", 4) == 0 && format == TOPOLOGY_FORMAT && nodes < NO_NODE &&
+                  edges < (1ULL << 40) && name_bytes < (1ULL << 48) &&
+                  topology_file_bytes(nodes, edges, name_bytes) == size;
+        const uint64_t* name_offsets = (const uint64_t*)(base + TOPOLOGY_HEADER_BYTES);
+        const uint64_t* offsets = name_offsets + nodes + 1;
+        if (ok && (name_offsets[nodes] != name_bytes || offsets[nodes] != 2 * edges))
+            ok = false;
+        if (!ok) {
+            munmap((void*)base, size);
+            return fail("not a topology file, or truncated");
+        }
+        if (base_)
+            munmap((void*)base_, size_);
+        base_ = base;
+        size_ = size;
+        nodes_ = nodes;
+        edges_ = edges;
+        name_offsets_ = name_offsets;
+        offsets_ = offsets;
+        targets_ = (const uint32_t*)(offsets + nodes + 1);
+        types_ = (const uint8_t*)(targets_ + 2 * edges);
+        names_ = (const char*)(types_ + nodes);
+        return true;
+    }
+
+    // Checks that every offset, target and type is in range. O(nodes + edges).
+    bool validate() const {
+        for (uint64_t id = 0; id < nodes_; id++) {
+            if (name_offsets_[id] > name_offsets_[id + 1] || offsets_[id] > offsets_[id + 1] ||
+                types_[id] > (uint8_t)NodeType::PEER)
+                return false;
+        }
+        for (uint64_t i = 0; i < 2 * edges_; i++)
+            if (targets_[i] >= nodes_)
+                return false;
+        return name_offsets_[0] == 0 && offsets_[0] == 0;
+    }
+
+    size_t node_count() const { return nodes_; }
+    size_t edge_count() const { return edges_; }
+    size_t file_bytes() const { return size_; }
+
+    std::string_view name(uint32_t id) const {
+        return std::string_view(names_ + name_offsets_[id], name_offsets_[id + 1] - name_offsets_[id]);
+    }
+    NodeType type(uint32_t id) const { return (NodeType)types_[id]; }
+    uint32_t degree(uint32_t id) const { return (uint32_t)(offsets_[id + 1] - offsets_[id]); }
+    NeighborRange neighbors(uint32_t id) const { return {targets_ + offsets_[id], targets_ + offsets_[id + 1]}; }
+
+private:
+    const char* base_ = nullptr;
+    size_t size_ = 0;
+    uint64_t nodes_ = 0, edges_ = 0;
+    const uint64_t* name_offsets_ = nullptr;
+    const uint64_t* offsets_ = nullptr;
+    const uint32_t* targets_ = nullptr;
+    const uint8_t* types_ = nullptr;
+    const char* names_ = nullptr;
+};
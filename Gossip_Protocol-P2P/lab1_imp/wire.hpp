@@ -0,0 +1,273 @@
+// wire.hpp
+/*
+  Length-prefixed binary framing shared by PeerNode and SeedServer.
+
+  Every message is a fixed 32-byte header followed by payloadLen bytes of payload.
+  All integers are big-endian:
+
+      offset  size  field
+      0       1     type        (MsgType)
+      1       1     version     (WIRE_VERSION)
+      2       1     hops        (GOSSIP: links traversed on arrival, saturating at 255; else 0)
+      3       1     flags       (FRAME_MORE, FRAME_RETRY; other bits reserved, 0)
+      4       4     payloadLen
+      8       8     originId    (makeOriginId(IP, port) of the node that created the message)
+      16      8     seq         (per-origin sequence number, for GOSSIP with the origin's random
+                                 per-run incarnation in the high 32 bits; PING nonce for PING/PONG)
+      24      8     originTs    (origin time in nanoseconds: monotonicNs() for GOSSIP, so receive
+                                 latency is exact between processes on one host; wall clock
+                                 for everything else)
+
+  FrameReader accumulates stream bytes for one connection and hands out every complete frame
+  in its buffer as a header plus a string_view into that buffer, so parsing many frames out
+  of one read() allocates nothing.
+*/
+#pragma once
+#include <arpa/inet.h>
+#include <endian.h>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class MsgType : uint8_t {
+    Gossip   = 1, // payload: gossip text "<timestamp>:<IP>:Msg#<n>"
+    Ping     = 2, // no payload
+    Pong     = 3, // no payload, echoes the PING seq
+    Register = 4, // payload: "IP:Port" of the registering peer
+    GetPeers = 5, // payload: empty (full list as PEER_LIST) or "since=<version>;<epoch>" (PEER_DELTA)
+    PeerList = 6, // payload: comma-delimited "IP:Port" list, paged with FRAME_MORE
+    Dead     = 7, // payload: "DeadIP:DeadPort[,DeadIP:DeadPort...]", originId = reporter, originTs = report time
+    PeerDelta = 8, // payload: "<epoch>;<version>;<full 0|1>;<added list>;<removed list>", paged with FRAME_MORE
+    Digest   = 9, // payload: "<set size u32><IBLT cells>" over recent gossip ids (anti_entropy.hpp)
+    Want     = 10, // payload: 8-byte gossip ids to re-send; FRAME_RETRY: "<cells u32>" to retry with
+    Ack      = 11, // payload: 8-byte ids of gossip received over UDP (datagram.hpp, retransmission on)
+};
+
+// Scheduling class of a frame. Control frames (liveness and membership) are sent ahead of
+// queued data frames (gossip, anti-entropy) and handled before the data frames received with
+// them, so a burst of gossip cannot hold a PONG back long enough to get its sender declared dead.
+enum class TrafficClass : uint8_t { Control = 0, Data = 1 };
+const int TRAFFIC_CLASSES = 2;
+
+inline TrafficClass trafficClassOf(MsgType type) {
+    switch (type) {
+    case MsgType::Ping:
+    case MsgType::Pong:
+    case MsgType::Register:
+    case MsgType::Dead:
+        return TrafficClass::Control;
+    default:
+        return TrafficClass::Data;
+    }
+}
+
+// Set on every frame of a multi-frame reply except the last one.
+const uint8_t FRAME_MORE = 0x1;
+// Set on a WANT answering a DIGEST that could not be decoded.
+const uint8_t FRAME_RETRY = 0x2;
+
+const uint8_t WIRE_VERSION = 2;
+const size_t FRAME_HEADER_SIZE = 32;
+const uint32_t MAX_FRAME_PAYLOAD = 1 << 20;
+
+struct FrameHeader {
+    MsgType type;
+    uint8_t hops;
+    uint8_t flags;
+    uint32_t payloadLen;
+    uint64_t originId;
+    uint64_t seq;
+    uint64_t originTs;
+};
+
+// Packs an IPv4 address and port into the 64-bit origin id used in frame headers.
+inline uint64_t makeOriginId(const std::string &ip, int port) {
+    struct in_addr addr;
+    uint32_t ipv4 = inet_pton(AF_INET, ip.c_str(), &addr) == 1 ? ntohl(addr.s_addr) : 0;
+    return ((uint64_t)ipv4 << 16) | (uint16_t)port;
+}
+
+inline std::string originIdToString(uint64_t id) {
+    struct in_addr addr;
+    addr.s_addr = htonl((uint32_t)(id >> 16));
+    char ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &addr, ip, sizeof(ip));
+    return std::string(ip) + ":" + std::to_string(id & 0xffff);
+}
+
+// Splits "IP:Port" into its parts; returns false if there is no ':'.
+inline bool splitHostPort(std::string_view addr, std::string &ip, std::string &port) {
+    size_t pos = addr.rfind(':');
+    if (pos == std::string_view::npos)
+        return false;
+    ip.assign(addr.data(), pos);
+    port.assign(addr.data() + pos + 1, addr.size() - pos - 1);
+    return true;
+}
+
+inline uint64_t wallClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// CLOCK_MONOTONIC in nanoseconds: never steps, and is shared by all processes on one host.
+inline uint64_t monotonicNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Appends one encoded frame to out.
+inline void appendFrame(std::string &out, MsgType type, uint64_t originId, uint64_t seq,
+                        uint64_t originTs, std::string_view payload = std::string_view(), uint8_t flags = 0,
+                        uint8_t hops = 0) {
+    char hdr[FRAME_HEADER_SIZE];
+    hdr[0] = (char)type;
+    hdr[1] = (char)WIRE_VERSION;
+    hdr[2] = (char)hops;
+    hdr[3] = (char)flags;
+    uint32_t len = htobe32((uint32_t)payload.size());
+    uint64_t oid = htobe64(originId), sq = htobe64(seq), ts = htobe64(originTs);
+    memcpy(hdr + 4, &len, 4);
+    memcpy(hdr + 8, &oid, 8);
+    memcpy(hdr + 16, &sq, 8);
+    memcpy(hdr + 24, &ts, 8);
+    out.append(hdr, FRAME_HEADER_SIZE);
+    out.append(payload.data(), payload.size());
+}
+
+// Class of an encoded frame, from its type byte.
+inline TrafficClass trafficClassOf(const std::string &frame) { return trafficClassOf((MsgType)(uint8_t)frame[0]); }
+
+inline FrameHeader decodeHeader(const char *p) {
+    FrameHeader h;
+    uint32_t len;
+    uint64_t oid, sq, ts;
+    memcpy(&len, p + 4, 4);
+    memcpy(&oid, p + 8, 8);
+    memcpy(&sq, p + 16, 8);
+    memcpy(&ts, p + 24, 8);
+    h.type = (MsgType)(uint8_t)p[0];
+    h.hops = (uint8_t)p[2];
+    h.flags = (uint8_t)p[3];
+    h.payloadLen = be32toh(len);
+    h.originId = be64toh(oid);
+    h.seq = be64toh(sq);
+    h.originTs = be64toh(ts);
+    return h;
+}
+
+class FrameReader {
+public:
+    explicit FrameReader(size_t capacity = 16 * 1024) : buf_(capacity) {}
+
+    // Free space to read() into; call commit() with the number of bytes read.
+    char *writePtr() {
+        if (end_ == buf_.size())
+            makeRoom();
+        return buf_.data() + end_;
+    }
+    // Makes room the same way as writePtr(), so the two can be evaluated in either order.
+    size_t writable() {
+        if (end_ == buf_.size())
+            makeRoom();
+        return buf_.size() - end_;
+    }
+    void commit(size_t n) { end_ += n; }
+
+    // Calls onFrame(header, payload) for each complete frame and keeps any partial frame.
+    // onFrame returns false to stop early (e.g. the connection was closed). Returns false
+    // if parsing stopped early or the stream is corrupt (see error()).
+    template <typename F>
+    bool consume(F &&onFrame) {
+        while (end_ - start_ >= FRAME_HEADER_SIZE) {
+            const char *p = buf_.data() + start_;
+            if ((uint8_t)p[1] != WIRE_VERSION) {
+                error_ = true;
+                return false;
+            }
+            FrameHeader h = decodeHeader(p);
+            if (h.payloadLen > MAX_FRAME_PAYLOAD) {
+                error_ = true;
+                return false;
+            }
+            if (end_ - start_ < FRAME_HEADER_SIZE + h.payloadLen) {
+                if (FRAME_HEADER_SIZE + h.payloadLen > buf_.size())
+                    buf_.resize(FRAME_HEADER_SIZE + h.payloadLen);
+                break;
+            }
+            start_ += FRAME_HEADER_SIZE + h.payloadLen;
+            if (!onFrame(h, std::string_view(p + FRAME_HEADER_SIZE, h.payloadLen)))
+                return false;
+        }
+        if (start_ == end_)
+            start_ = end_ = 0;
+        return true;
+    }
+
+    // Like consume(), but among the complete frames received so far the control frames are
+    // handled first, then the data frames in order. A PONG read together with a burst of gossip
+    // does not wait for the gossip to be forwarded.
+    template <typename F>
+    bool consumeControlFirst(F &&onFrame) {
+        size_t limit = start_; // end of the complete, well-formed frames
+        bool corrupt = false;
+        while (end_ - limit >= FRAME_HEADER_SIZE) {
+            const char *p = buf_.data() + limit;
+            if ((uint8_t)p[1] != WIRE_VERSION) {
+                corrupt = true;
+                break;
+            }
+            FrameHeader h = decodeHeader(p);
+            if (h.payloadLen > MAX_FRAME_PAYLOAD) {
+                corrupt = true;
+                break;
+            }
+            if (end_ - limit < FRAME_HEADER_SIZE + h.payloadLen) {
+                if (FRAME_HEADER_SIZE + h.payloadLen > buf_.size())
+                    buf_.resize(FRAME_HEADER_SIZE + h.payloadLen);
+                break;
+            }
+            limit += FRAME_HEADER_SIZE + h.payloadLen;
+            if (trafficClassOf(h.type) == TrafficClass::Control &&
+                !onFrame(h, std::string_view(p + FRAME_HEADER_SIZE, h.payloadLen)))
+                return false;
+        }
+        while (start_ < limit) {
+            const char *p = buf_.data() + start_;
+            FrameHeader h = decodeHeader(p);
+            start_ += FRAME_HEADER_SIZE + h.payloadLen;
+            if (trafficClassOf(h.type) == TrafficClass::Data &&
+                !onFrame(h, std::string_view(p + FRAME_HEADER_SIZE, h.payloadLen)))
+                return false;
+        }
+        if (corrupt) {
+            error_ = true;
+            return false;
+        }
+        if (start_ == end_)
+            start_ = end_ = 0;
+        return true;
+    }
+
+    bool error() const { return error_; }
+
+private:
+    std::vector<char> buf_;
+    size_t start_ = 0; // first unparsed byte
+    size_t end_ = 0;   // one past the last received byte
+    bool error_ = false;
+
+    // Moves the unparsed tail to the front; grows only when a single frame needs more space.
+    void makeRoom() {
+        if (start_ > 0) {
+            memmove(buf_.data(), buf_.data() + start_, end_ - start_);
+            end_ -= start_;
+            start_ = 0;
+        } else {
+            buf_.resize(buf_.size() * 2);
+        }
+    }
+};
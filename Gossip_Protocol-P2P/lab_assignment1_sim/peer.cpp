@@ -11,6 +11,7 @@
 #include <random>
 #include <ctime>
 #include "seed.cpp" // For simplicity, we include seed.cpp directly.
+#include "dedup.hpp" // Bounded-memory duplicate filter, a copy of lab1_imp/dedup.hpp.
 using namespace std;
 
 class PeerNode {
@@ -19,8 +20,8 @@ string ip; // This peer's IP address
 string port; // This peer's port number
 // Set of connected peer IDs (each in "IP:Port" format)
 unordered_set<string> connectedPeers;
-// Set to record processed messages (to avoid duplicate forwarding)
-unordered_set<string> messageList;
+// Records processed messages (to avoid duplicate forwarding), keyed on a 64-bit hash of the text
+MessageDedup messageList;
 // List of all available seed nodes (read from config)
 vector<SeedNode*> seedNodes;
 ofstream outputFile; // Log file stream (appended to outputfile.txt)
@@ -124,9 +125,8 @@ void generateMessages() {
 // if it has not yet been processed.
 void broadcastMessage(const string &message, const string &fromPeer) {
     lock_guard<mutex> lock(mtx);
-    if (messageList.find(message) != messageList.end())
+    if (!messageList.checkAndInsert(hashMessage(message)))
         return;
-    messageList.insert(message);
     for (auto peer : connectedPeers) {
         if (peer == fromPeer)
             continue;
@@ -141,9 +141,8 @@ void broadcastMessage(const string &message, const string &fromPeer) {
 // it prints the message (with a local timestamp and the IP of the sender) and then forwards it.
 void receiveMessage(const string &message, const string &fromPeer) {
     lock_guard<mutex> lock(mtx);
-    if (messageList.find(message) != messageList.end())
+    if (!messageList.checkAndInsert(hashMessage(message)))
         return;
-    messageList.insert(message);
     // Log reception from a neighbor (the sender's IP is included in message).
     cout << message << endl;
     outputFile << message << endl;